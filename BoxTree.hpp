@@ -0,0 +1,144 @@
+/*
+
+  Bounding volume hierarchy over integer boxes.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public License
+  (LGPL) as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef BOXTREE_H
+#define BOXTREE_H
+
+#include <vector>
+#include <algorithm>
+
+#include "GeoCommon.hpp"
+
+// Finds the boxes overlapping a given box without looking at all of them,
+// the broad phase of Intersection::testIntersection( fname, outname ).
+// Nodes split their boxes at the median center along the longest axis and
+// live in one array, the two children of a node are next to each other.
+// The boxes are not copied and must outlive the tree.
+class BoxTree {
+public:
+	enum { LEAF_SIZE = 4, MAX_DEPTH = 64 } ;
+
+	BoxTree( const BoundingBox* b, int n ) {
+		boxes = b ;
+		items.resize( n ) ;
+		for ( int i = 0 ; i < n ; i ++ )
+			items[i] = i ;
+		nodes.reserve( n > 0 ? 2 * ( n / LEAF_SIZE ) + 1 : 0 ) ;
+		if ( n > 0 ) {
+			nodes.push_back( Node( ) ) ;
+			build( 0, 0, n ) ;
+		}
+	};
+
+	/// Boxes overlap unless one begins after the other ends, touching counts
+	static int overlap( const BoundingBox& a, const BoundingBox& b ) {
+		return ! ( a.begin.x > b.end.x || a.begin.y > b.end.y || a.begin.z > b.end.z ||
+			b.begin.x > a.end.x || b.begin.y > a.end.y || b.begin.z > a.end.z ) ;
+	};
+
+	/// Call f( i ) for every box i overlapping b, in no particular order
+	template <class F>
+	void query( const BoundingBox& b, F f ) const {
+		if ( nodes.empty( ) )
+			return ;
+		int stack[ MAX_DEPTH ] ;
+		int top = 0 ;
+		stack[ top ++ ] = 0 ;
+		while ( top > 0 ) {
+			const Node& nd = nodes[ stack[ -- top ] ] ;
+			if ( ! overlap( nd.box, b ) )
+				continue ;
+			if ( nd.count > 0 ) {
+				for ( int k = nd.first ; k < nd.first + nd.count ; k ++ )
+					if ( overlap( boxes[ items[k] ], b ) )
+						f( items[k] ) ;
+			} else {
+				stack[ top ++ ] = nd.first + 1 ;
+				stack[ top ++ ] = nd.first ;
+			}
+		}
+	};
+
+	int numNodes( ) const { return (int) nodes.size( ) ; } ;
+
+private:
+	struct Node {
+		BoundingBox box ;
+		int first ; // leaf: first entry of items, inner node: first child
+		int count ; // boxes in a leaf, 0 for an inner node
+	};
+
+	const BoundingBox* boxes ;
+	std::vector<int> items ;
+	std::vector<Node> nodes ;
+
+	// node covers items[begin .. end)
+	void build( int node, int begin, int end ) {
+		BoundingBox box = boxes[ items[begin] ] ;
+		Point3i lo, hi ; // range of twice the box centers
+		lo.x = hi.x = box.begin.x + box.end.x ;
+		lo.y = hi.y = box.begin.y + box.end.y ;
+		lo.z = hi.z = box.begin.z + box.end.z ;
+		for ( int k = begin + 1 ; k < end ; k ++ ) {
+			const BoundingBox& b = boxes[ items[k] ] ;
+			box.begin.x = std::min( box.begin.x, b.begin.x ) ;
+			box.begin.y = std::min( box.begin.y, b.begin.y ) ;
+			box.begin.z = std::min( box.begin.z, b.begin.z ) ;
+			box.end.x = std::max( box.end.x, b.end.x ) ;
+			box.end.y = std::max( box.end.y, b.end.y ) ;
+			box.end.z = std::max( box.end.z, b.end.z ) ;
+			lo.x = std::min( lo.x, b.begin.x + b.end.x ) ; hi.x = std::max( hi.x, b.begin.x + b.end.x ) ;
+			lo.y = std::min( lo.y, b.begin.y + b.end.y ) ; hi.y = std::max( hi.y, b.begin.y + b.end.y ) ;
+			lo.z = std::min( lo.z, b.begin.z + b.end.z ) ; hi.z = std::max( hi.z, b.begin.z + b.end.z ) ;
+		}
+		nodes[node].box = box ;
+
+		// all centers equal, splitting would not help
+		if ( end - begin <= LEAF_SIZE || ( lo.x == hi.x && lo.y == hi.y && lo.z == hi.z ) ) {
+			nodes[node].first = begin ;
+			nodes[node].count = end - begin ;
+			return ;
+		}
+
+		int axis = 0 ;
+		if ( hi.y - lo.y > hi.x - lo.x )
+			axis = 1 ;
+		if ( hi.z - lo.z > ( axis == 0 ? hi.x - lo.x : hi.y - lo.y ) )
+			axis = 2 ;
+		const BoundingBox* bx = boxes ;
+		int mid = ( begin + end ) / 2 ;
+		std::nth_element( items.begin( ) + begin, items.begin( ) + mid, items.begin( ) + end,
+			[bx, axis]( int a, int b ) { return center( bx[a], axis ) < center( bx[b], axis ) ; } ) ;
+
+		int child = (int) nodes.size( ) ;
+		nodes[node].first = child ;
+		nodes[node].count = 0 ;
+		nodes.push_back( Node( ) ) ;
+		nodes.push_back( Node( ) ) ;
+		build( child, begin, mid ) ;
+		build( child + 1, mid, end ) ;
+	};
+
+	// twice the center of b along axis
+	static int center( const BoundingBox& b, int axis ) {
+		return axis == 0 ? b.begin.x + b.end.x : ( axis == 1 ? b.begin.y + b.end.y : b.begin.z + b.end.z ) ;
+	};
+};
+
+#endif
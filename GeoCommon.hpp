@@ -46,16 +46,6 @@ struct TriangleList {
 	TriangleList* next ;
 };
 
-struct VertexList {
-	float vt[3] ;
-	VertexList* next ;
-};
-
-struct IndexedTriangleList {
-	int vt[3] ;
-	IndexedTriangleList* next ;
-};
-
 // 3d point with float coordinates
 typedef struct {
 	float x, y, z;
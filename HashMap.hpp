@@ -25,21 +25,14 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <new>
 
 #define HASH_LENGTH  20
 #define MAX_HASH (1<<HASH_LENGTH)
 #define HASH_BIT_2 10
 #define HASH_BIT_4 5
 
-struct ElementList
-{
-	int n1;
-	int n2;
-	int index ;
-	int location ;
-	ElementList* next;
-};
-
 struct ElementList2
 {
 	int n1;
@@ -58,92 +51,128 @@ struct ElementList4
 	ElementList4* next;
 };
 
+// Face vertices of the intersection-free contouring, keyed by the two
+// nodes that share the face. Open addressing with linear probing over one
+// array of entries, which doubles when it is half full: there is no
+// allocation per insert, and a small tree gets a small table. The node
+// addresses are used in full and mixed, so nothing is lost on 64-bit builds.
 class HashMap
 {
-/// Hash table
-	ElementList *table[MAX_HASH];
+	struct Entry
+	{
+		uintptr_t k1 ;
+		uintptr_t k2 ; // 0 if the entry is free
+		int index ;
+	};
 
-/// Create hash key
-	int CreateKey( int k1, int k2 )
+	Entry* table ;
+	size_t mask ;  // table size - 1, the size is a power of two
+	size_t count ;
+
+	/// Mix the two keys into a slot, finalizer of MurmurHash3
+	size_t slot( uintptr_t k1, uintptr_t k2 ) const
 	{
-		int ind = (	(( k1 & ( (1<<HASH_BIT_2) - 1 )) << ( HASH_BIT_2 )) |
-					( k2 & ( (1<<HASH_BIT_2) - 1)) ) 
-					& ((1<<HASH_LENGTH) - 1);
+		unsigned long long h = (unsigned long long) k1 * 0x9E3779B97F4A7C15ULL ;
+		h ^= (unsigned long long) k2 + 0x632BE59BD9B4E019ULL + ( h << 6 ) + ( h >> 2 ) ;
+		h ^= h >> 33 ;
+		h *= 0xFF51AFD7ED558CCDULL ;
+		h ^= h >> 33 ;
+		h *= 0xC4CEB9FE1A85EC53ULL ;
+		h ^= h >> 33 ;
+		return (size_t) h & mask ;
+	}
 
-		return ind;
+	void allocate( size_t size )
+	{
+		// calloc leaves every k2 at 0, i.e. free
+		table = (Entry*) calloc( size, sizeof( Entry ) ) ;
+		if ( table == NULL )
+		{
+			throw std::bad_alloc( ) ;
+		}
+		mask = size - 1 ;
+	}
+
+	void grow( )
+	{
+		Entry* old = table ;
+		size_t oldSize = mask + 1 ;
+		allocate( 2 * oldSize ) ;
+		for ( size_t i = 0 ; i < oldSize ; i ++ )
+		{
+			if ( old[i].k2 != 0 )
+			{
+				size_t j = slot( old[i].k1, old[i].k2 ) ;
+				while ( table[j].k2 != 0 )
+				{
+					j = ( j + 1 ) & mask ;
+				}
+				table[j] = old[i] ;
+			}
+		}
+		free( old ) ;
 	}
 
 public:
 
+	enum { INITIAL_SIZE = 1024 } ;
+
 	/// Constructor
 	HashMap ( )
 	{
-		for ( int i = 0; i < MAX_HASH; i ++ )
-		{
-			table[i] = NULL;
-		}
+		allocate( INITIAL_SIZE ) ;
+		count = 0 ;
 	};
 
-	/// Lookup Method
-	int FindKey( int k1, int k2, int& index, int& location )
+	/// Lookup Method, k2 must not be NULL
+	int FindKey( const void* k1, const void* k2, int& index ) const
 	{
-		/// Create hash key
-		int ind = CreateKey ( k1, k2 );
-
-		/// Find it in the table
-		ElementList *p = table[ind];
-		while (p)
+		uintptr_t a = (uintptr_t) k1, b = (uintptr_t) k2 ;
+		for ( size_t j = slot( a, b ) ; table[j].k2 != 0 ; j = ( j + 1 ) & mask )
 		{
-			if ((p->n1 == k1) && (p->n2 == k2))
+			if ( table[j].k1 == a && table[j].k2 == b )
 			{
-				index = p->index ;
-				location = p->location ;
+				index = table[j].index ;
 				return 1 ;
 			}
-			p = p->next;
 		}
-
 		return 0 ;
 	};
 
-
-	/// Insertion method
-	void InsertKey ( int k1, int k2, int index, int location )
+	/// Insertion method, for a key that is not in the table yet
+	void InsertKey( const void* k1, const void* k2, int index )
 	{
-		/// Create hash key
-		int ind = CreateKey ( k1, k2 );
-
-		/// Create hash entry
-		ElementList *node = new ElementList;
-		
-		node->index = index ;
-		node->location = location ;
-		node->n1 = k1 ;
-		node->n2 = k2 ;
-		node->next = table[ ind ] ;
-		table[ ind ] = node ;
+		if ( 2 * ( count + 1 ) > mask + 1 )
+		{
+			grow( ) ;
+		}
+		uintptr_t a = (uintptr_t) k1, b = (uintptr_t) k2 ;
+		size_t j = slot( a, b ) ;
+		while ( table[j].k2 != 0 )
+		{
+			j = ( j + 1 ) & mask ;
+		}
+		table[j].k1 = a ;
+		table[j].k2 = b ;
+		table[j].index = index ;
+		count ++ ;
 	};
 
+	/// Number of entries
+	size_t size( ) const { return count ; } ;
+
+	/// Bytes held by the table
+	size_t bytes( ) const { return ( mask + 1 ) * sizeof( Entry ) ; } ;
+
 	// Destruction method
 	~HashMap()
 	{
-		ElementList *p, *pp;
-
-		for ( int i = 0; i < MAX_HASH; i ++)
-		{
-			p = table[i];
-
-			while (p)
-			{
-				pp = p->next;
-				delete p;
-				p = pp;
-			}
-
-		}
-
+		free( table ) ;
 	};
 
+private:
+	HashMap( const HashMap& ) ;
+	HashMap& operator=( const HashMap& ) ;
 };
 
 class HashMap2
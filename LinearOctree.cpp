@@ -0,0 +1,292 @@
+/*
+
+  Implementation of the linear octree.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public License
+  (LGPL) as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <stdio.h>
+#include <time.h>
+
+#include "LinearOctree.hpp"
+
+LinearOctree::LinearOctree( Octree* tree )
+{
+	dimen = tree->dimen ;
+	maxDepth = tree->maxDepth ;
+	actualTris = 0 ;
+	int st[3] = {0, 0, 0} ;
+	root = build( tree, tree->root, st, dimen ) ;
+	printf("Linear octree: %d internal nodes, %d leaves, %lu bytes\n",
+		(int) internals.size( ), numLeaves( ), (unsigned long) memoryBytes( ) ) ;
+}
+
+size_t LinearOctree::memoryBytes( )
+{
+	return internals.size( ) * sizeof( LinearInternal ) + childRefs.size( ) * sizeof( NodeRef ) +
+		morton.size( ) * sizeof( unsigned long long ) + signs.size( ) + height.size( ) + pseudo.size( ) +
+		mp.size( ) * sizeof( float ) + qef.size( ) * sizeof( float ) ;
+}
+
+// interleave the bits of st, x first, so that sorting by the code is the
+// same as visiting children 0..7 (see vertMap) depth-first
+unsigned long long LinearOctree::mortonCode( int st[3] )
+{
+	unsigned long long code = 0 ;
+	for ( int b = 20 ; b >= 0 ; b -- ) {
+		code = ( code << 3 ) |
+			( (unsigned long long) ( ( st[0] >> b ) & 1 ) << 2 ) |
+			( (unsigned long long) ( ( st[1] >> b ) & 1 ) << 1 ) |
+			(unsigned long long) ( ( st[2] >> b ) & 1 ) ;
+	}
+	return code ;
+}
+
+// depth-first copy of the pointer tree, leaves come out in Morton order
+NodeRef LinearOctree::build( Octree* tree, OctreeNode* node, int st[3], int len )
+{
+	if ( node == NULL )
+		return EMPTY_REF ;
+
+	if ( node->getType() == INTERNAL ) {
+		InternalNode* inode = (InternalNode*) node ;
+		NodeRef ref = (NodeRef) internals.size( ) ;
+		LinearInternal in ;
+		in.childMask = 0 ;
+		in.firstChild = (int) childRefs.size( ) ;
+		for ( int i = 0 ; i < 8 ; i ++ ) {
+			if ( inode->child[i] != NULL )
+				in.childMask |= ( 1 << i ) ;
+		}
+		internals.push_back( in ) ;
+
+		// reserve the child refs first so that they are contiguous
+		int k = in.firstChild ;
+		for ( int i = 0 ; i < 8 ; i ++ ) {
+			if ( inode->child[i] != NULL )
+				childRefs.push_back( EMPTY_REF ) ;
+		}
+		int nlen = len / 2 ;
+		int nst[3] ;
+		for ( int i = 0 ; i < 8 ; i ++ ) {
+			if ( inode->child[i] == NULL )
+				continue ;
+			nst[0] = st[0] + vertMap[i][0] * nlen ;
+			nst[1] = st[1] + vertMap[i][1] * nlen ;
+			nst[2] = st[2] + vertMap[i][2] * nlen ;
+			NodeRef c = build( tree, inode->child[i], nst, nlen ) ;
+			childRefs[ k ++ ] = c ;
+		}
+		return ref ;
+	}
+
+	// leaf or pseudo-leaf, both have the QEFMixin fields
+	QEFMixin* q = (QEFMixin*) node ;
+
+	NodeRef ref = LEAF_REF | (NodeRef) signs.size( ) ;
+	morton.push_back( mortonCode( st ) ) ;
+	signs.push_back( q->getSigns( ) ) ;
+	height.push_back( q->height ) ;
+	pseudo.push_back( node->getType() == PSEUDOLEAF ) ;
+	for ( int i = 0 ; i < 3 ; i ++ )
+		mp.push_back( q->mp[i] ) ;
+	if ( tree->hasQEF ) {
+		QEFData d ;
+		if ( q->qef != QEFPool::NONE )
+			d = tree->getQEF( q->qef ) ;
+		for ( int i = 0 ; i < 6 ; i ++ )
+			qef.push_back( d.ata[i] ) ;
+		for ( int i = 0 ; i < 3 ; i ++ )
+			qef.push_back( d.atb[i] ) ;
+		qef.push_back( d.btb ) ;
+	}
+	return ref ;
+}
+
+void LinearOctree::releaseQEF( )
+{
+	std::vector<float>( ).swap( qef ) ;
+}
+
+void LinearOctree::genMesh( Mesh& mesh )
+{
+	releaseQEF( ) ;
+	mesh.clear( ) ;
+	actualTris = 0 ;
+
+	clock_t start = clock( ) ;
+	cellProcContour( root, mesh.triangles ) ;
+	clock_t finish = clock( ) ;
+	printf("Time used: %f seconds.\n", (float) (finish - start) / (float) CLOCKS_PER_SEC ) ;
+
+	// vertex i is leaf i
+	mesh.vertices = mp ;
+}
+
+void LinearOctree::genContour( char* fname, int bigEndian )
+{
+	Mesh mesh ;
+	genMesh( mesh ) ;
+	mesh.writePLY( fname, bigEndian ) ;
+	printf("Actual triangles written: %d\n", actualTris ) ;
+}
+
+// same traversal as Octree::cellProcContour()
+void LinearOctree::cellProcContour( NodeRef node, std::vector<unsigned int>& faces )
+{
+	if ( ! isInternal( node ) )
+		return ;
+
+	NodeRef child[8] ;
+	getChildren( node, child ) ;
+
+	for ( int i = 0 ; i < 8 ; i ++ ) // 8 Cell calls on children
+		cellProcContour( child[ i ], faces ) ;
+
+	for ( int i = 0 ; i < 12 ; i ++ ) { // 12 face calls
+		NodeRef fcd[2] = { child[ cellProcFaceMask[ i ][ 0 ] ], child[ cellProcFaceMask[ i ][ 1 ] ] } ;
+		faceProcContour( fcd, cellProcFaceMask[ i ][ 2 ], faces ) ;
+	}
+
+	for ( int i = 0 ; i < 6 ; i ++ ) { // 6 edge calls
+		NodeRef ecd[4] ;
+		for ( int j = 0 ; j < 4 ; j ++ )
+			ecd[j] = child[ cellProcEdgeMask[ i ][ j ] ] ;
+		edgeProcContour( ecd, cellProcEdgeMask[ i ][ 4 ], faces ) ;
+	}
+}
+
+void LinearOctree::faceProcContour( NodeRef node[2], int dir, std::vector<unsigned int>& faces )
+{
+	if ( node[0] == EMPTY_REF || node[1] == EMPTY_REF )
+		return ;
+	if ( ! isInternal( node[0] ) && ! isInternal( node[1] ) )
+		return ;
+
+	NodeRef child[2][8] ;
+	for ( int j = 0 ; j < 2 ; j ++ ) {
+		if ( isInternal( node[j] ) )
+			getChildren( node[j], child[j] ) ;
+	}
+
+	// 4 face calls
+	NodeRef fcd[2] ;
+	for ( int i = 0 ; i < 4 ; i ++ ) {
+		int c[2] = { faceProcFaceMask[ dir ][ i ][ 0 ], faceProcFaceMask[ dir ][ i ][ 1 ] } ;
+		for ( int j = 0 ; j < 2 ; j ++ )
+			fcd[j] = isInternal( node[j] ) ? child[j][ c[j] ] : node[j] ;
+		faceProcContour( fcd, faceProcFaceMask[ dir ][ i ][ 2 ], faces ) ;
+	}
+
+	// 4 edge calls
+	int orders[2][4] = {{ 0, 0, 1, 1 }, { 0, 1, 0, 1 }} ;
+	NodeRef ecd[4] ;
+	for ( int i = 0 ; i < 4 ; i ++ ) {
+		int c[4] = { faceProcEdgeMask[ dir ][ i ][ 1 ], faceProcEdgeMask[ dir ][ i ][ 2 ],
+					 faceProcEdgeMask[ dir ][ i ][ 3 ], faceProcEdgeMask[ dir ][ i ][ 4 ] } ;
+		int* order = orders[ faceProcEdgeMask[ dir ][ i ][ 0 ] ] ;
+		for ( int j = 0 ; j < 4 ; j ++ )
+			ecd[j] = isInternal( node[ order[j] ] ) ? child[ order[j] ][ c[j] ] : node[ order[j] ] ;
+		edgeProcContour( ecd, faceProcEdgeMask[ dir ][ i ][ 5 ], faces ) ;
+	}
+}
+
+void LinearOctree::edgeProcContour( NodeRef node[4], int dir, std::vector<unsigned int>& faces )
+{
+	if ( node[0] == EMPTY_REF || node[1] == EMPTY_REF || node[2] == EMPTY_REF || node[3] == EMPTY_REF )
+		return ;
+
+	if ( ! isInternal( node[0] ) && ! isInternal( node[1] ) && ! isInternal( node[2] ) && ! isInternal( node[3] ) ) {
+		processEdgeWrite( node, dir, faces ) ;
+		return ;
+	}
+
+	NodeRef child[4][8] ;
+	for ( int j = 0 ; j < 4 ; j ++ ) {
+		if ( isInternal( node[j] ) )
+			getChildren( node[j], child[j] ) ;
+	}
+
+	// 2 edge calls
+	NodeRef ecd[4] ;
+	for ( int i = 0 ; i < 2 ; i ++ ) {
+		for ( int j = 0 ; j < 4 ; j ++ )
+			ecd[j] = isInternal( node[j] ) ? child[j][ edgeProcEdgeMask[ dir ][ i ][ j ] ] : node[j] ;
+		edgeProcContour( ecd, edgeProcEdgeMask[ dir ][ i ][ 4 ], faces ) ;
+	}
+}
+
+static inline void emitTriangle( std::vector<unsigned int>& faces, int a, int b, int c )
+{
+	faces.push_back( a ) ;
+	faces.push_back( b ) ;
+	faces.push_back( c ) ;
+}
+
+// same as Octree::processEdgeWrite(), the vertex index of a leaf is its number
+void LinearOctree::processEdgeWrite( NodeRef node[4], int dir, std::vector<unsigned int>& faces )
+{
+	int minht = maxDepth + 1, mini = -1 ;
+	int ind[4], sc[4] ;
+	int flip2 = 0 ;
+	for ( int i = 0 ; i < 4 ; i ++ ) {
+		int leaf = leafIndex( node[i] ) ;
+		int ed = processEdgeMask[dir][i] ;
+		int c1 = edgevmap[ed][0] ;
+		int c2 = edgevmap[ed][1] ;
+
+		if ( height[ leaf ] < minht ) {
+			minht = height[ leaf ] ;
+			mini = i ;
+			flip2 = ( getSign( leaf, c1 ) > 0 ) ;
+		}
+		ind[i] = leaf ;
+		sc[i] = ( getSign( leaf, c1 ) != getSign( leaf, c2 ) ) ;
+	}
+
+	if ( sc[ mini ] == 0 )
+		return ;
+
+	actualTris ++ ;
+	if ( flip2 == 0 ) {
+		if ( ind[0] == ind[1] )
+			emitTriangle( faces, ind[0], ind[3], ind[2] ) ;
+		else if ( ind[1] == ind[3] )
+			emitTriangle( faces, ind[0], ind[1], ind[2] ) ;
+		else if ( ind[3] == ind[2] )
+			emitTriangle( faces, ind[0], ind[1], ind[3] ) ;
+		else if ( ind[2] == ind[0] )
+			emitTriangle( faces, ind[1], ind[3], ind[2] ) ;
+		else { // quad, two triangles
+			emitTriangle( faces, ind[0], ind[1], ind[3] ) ;
+			emitTriangle( faces, ind[0], ind[3], ind[2] ) ;
+			actualTris ++ ;
+		}
+	} else {
+		if ( ind[0] == ind[1] )
+			emitTriangle( faces, ind[0], ind[2], ind[3] ) ;
+		else if ( ind[1] == ind[3] )
+			emitTriangle( faces, ind[0], ind[2], ind[1] ) ;
+		else if ( ind[3] == ind[2] )
+			emitTriangle( faces, ind[0], ind[3], ind[1] ) ;
+		else if ( ind[2] == ind[0] )
+			emitTriangle( faces, ind[1], ind[2], ind[3] ) ;
+		else {
+			emitTriangle( faces, ind[0], ind[3], ind[1] ) ;
+			emitTriangle( faces, ind[0], ind[2], ind[3] ) ;
+			actualTris ++ ;
+		}
+	}
+}
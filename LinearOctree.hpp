@@ -0,0 +1,108 @@
+/*
+
+  Pointer-free (linear) octree for contouring.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public License
+  (LGPL) as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef LINEAROCTREE_H
+#define LINEAROCTREE_H
+
+#include <vector>
+#include "octree.hpp"
+
+// A node is referred to by a 32-bit NodeRef instead of a pointer:
+//   EMPTY_REF              no node
+//   LEAF_REF | i           leaf or pseudo-leaf number i
+//   i                      internal node number i
+typedef unsigned int NodeRef ;
+const NodeRef EMPTY_REF = 0xFFFFFFFFu ;
+const NodeRef LEAF_REF = 0x80000000u ;
+
+// Internal node: which of the 8 children exist, and where the
+// refs of the existing ones start in LinearOctree::childRefs
+struct LinearInternal {
+	int firstChild ;
+	unsigned char childMask ;
+};
+
+/**
+ * Linear octree built from an Octree.
+ *
+ * Leaves and pseudo-leaves are stored in flat arrays in depth-first order,
+ * which is the order of the Morton codes of their st corners (x is the
+ * most significant bit of each level, like vertMap). The leaf number is
+ * also the index of its vertex in the output, and indexes the QEF data.
+ * Internal nodes store a child mask and the position of their children
+ * refs, so a node costs 5 bytes plus 4 per existing child instead of
+ * 8 child pointers and a type tag.
+ */
+class LinearOctree {
+public:
+	int dimen, maxDepth ;
+
+	// internal nodes, depth-first
+	std::vector<LinearInternal> internals ;
+	std::vector<NodeRef> childRefs ;
+
+	// leaves and pseudo-leaves, sorted by Morton code
+	std::vector<unsigned long long> morton ; // Morton code of st
+	std::vector<unsigned char> signs ;
+	std::vector<unsigned char> height ;
+	std::vector<unsigned char> pseudo ;      // 1 for pseudo-leaves
+	std::vector<float> mp ;                  // minimizer, 3 per leaf
+	std::vector<float> qef ;                 // ata[6], atb[3], btb per leaf, empty if released
+
+	NodeRef root ;
+	int actualTris ;
+
+	LinearOctree( Octree* tree ) ;
+
+	int numLeaves( ) { return (int) signs.size( ) ; } ;
+	size_t memoryBytes( ) ;
+
+	static unsigned long long mortonCode( int st[3] ) ;
+
+	/// Free the QEF array, genContour() does this before contouring
+	void releaseQEF( ) ;
+
+	/// Original dual contouring on the linear tree, same output as Octree::genMesh
+	void genMesh( Mesh& mesh ) ;
+	/// genMesh() written to a PLY file
+	void genContour( char* fname, int bigEndian = 1 ) ;
+
+	static int isLeaf( NodeRef n ) { return n != EMPTY_REF && ( n & LEAF_REF ) ; } ;
+	static int isInternal( NodeRef n ) { return ! ( n & LEAF_REF ) ; } ;
+	static int leafIndex( NodeRef n ) { return (int) ( n & ~LEAF_REF ) ; } ;
+	int getSign( int leaf, int corner ) { return ( signs[ leaf ] >> corner ) & 1 ; } ;
+
+	/// All 8 children of an internal node, EMPTY_REF where there is none
+	void getChildren( NodeRef n, NodeRef child[8] ) {
+		const LinearInternal& in = internals[ n ] ;
+		int k = in.firstChild ;
+		for ( int i = 0 ; i < 8 ; i ++ )
+			child[i] = ( in.childMask & ( 1 << i ) ) ? childRefs[ k ++ ] : EMPTY_REF ;
+	};
+
+private:
+	NodeRef build( Octree* tree, OctreeNode* node, int st[3], int len ) ;
+
+	void cellProcContour( NodeRef node, std::vector<unsigned int>& faces ) ;
+	void faceProcContour( NodeRef node[2], int dir, std::vector<unsigned int>& faces ) ;
+	void edgeProcContour( NodeRef node[4], int dir, std::vector<unsigned int>& faces ) ;
+	void processEdgeWrite( NodeRef node[4], int dir, std::vector<unsigned int>& faces ) ;
+};
+
+#endif
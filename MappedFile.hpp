@@ -0,0 +1,102 @@
+/*
+
+  Read-only mapping of a whole file into memory.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public License
+  (LGPL) as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+	// no mmap, fall back to a single read of the whole file
+#else
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+class MappedFile {
+public:
+	const char* data ; // first byte of the file
+	size_t size ;      // length of the file in bytes
+
+	MappedFile( ) {
+		data = NULL ;
+		size = 0 ;
+	};
+	~MappedFile( ) {
+		close( ) ;
+	};
+
+	/// Map the file, returns 1 on success and 0 on failure
+	int open( const char* fname ) {
+		close( ) ;
+#ifdef _WIN32
+		FILE* fin = fopen( fname, "rb" ) ;
+		if ( fin == NULL )
+			return 0 ;
+		fseek( fin, 0, SEEK_END ) ;
+		size = ftell( fin ) ;
+		fseek( fin, 0, SEEK_SET ) ;
+		char* buf = (char*) malloc( size ) ;
+		if ( fread( buf, 1, size, fin ) != size ) {
+			free( buf ) ;
+			fclose( fin ) ;
+			size = 0 ;
+			return 0 ;
+		}
+		fclose( fin ) ;
+		data = buf ;
+		return 1 ;
+#else
+		int fd = ::open( fname, O_RDONLY ) ;
+		if ( fd < 0 )
+			return 0 ;
+		struct stat sb ;
+		if ( fstat( fd, &sb ) != 0 || sb.st_size == 0 ) {
+			::close( fd ) ;
+			return 0 ;
+		}
+		void* p = mmap( NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0 ) ;
+		::close( fd ) ; // the mapping stays valid after the descriptor is closed
+		if ( p == MAP_FAILED )
+			return 0 ;
+		// the whole file is walked front to back
+		madvise( p, sb.st_size, MADV_SEQUENTIAL ) ;
+		data = (const char*) p ;
+		size = sb.st_size ;
+		return 1 ;
+#endif
+	};
+
+	void close( ) {
+		if ( data == NULL )
+			return ;
+#ifdef _WIN32
+		free( (void*) data ) ;
+#else
+		munmap( (void*) data, size ) ;
+#endif
+		data = NULL ;
+		size = 0 ;
+	};
+};
+
+#endif
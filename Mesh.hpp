@@ -0,0 +1,65 @@
+/*
+
+  Contoured surface held in memory.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public License
+  (LGPL) as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef MESH_H
+#define MESH_H
+
+#include <stdio.h>
+#include <vector>
+
+#include "PLYWriter.hpp"
+
+// Output of Octree::genMesh(), for callers that use the surface directly
+// instead of reading back a PLY file. Vertex i is vertices[3i .. 3i+2] and
+// triangle j is triangles[3j .. 3j+2]. Reusing a Mesh keeps the capacity
+// of its arrays.
+struct Mesh {
+	std::vector<float> vertices ;
+	std::vector<unsigned int> triangles ;
+	// leaf number of the octree cell of vertex i, -1 for the face and edge
+	// vertices of genMeshNoInter2(); empty if unknown. Used by Octree::verifyMesh()
+	std::vector<int> cells ;
+
+	int numVertices( ) const { return (int) ( vertices.size( ) / 3 ) ; } ;
+	int numTriangles( ) const { return (int) ( triangles.size( ) / 3 ) ; } ;
+
+	void clear( ) {
+		vertices.clear( ) ;
+		triangles.clear( ) ;
+		cells.clear( ) ;
+	};
+
+	/// Write as a binary PLY file, returns 0 if fname can not be opened
+	int writePLY( const char* fname, int bigEndian = 1 ) const {
+		FILE* fout = fopen( fname, "wb" ) ;
+		if ( fout == NULL )
+			return 0 ;
+		PLYStream ply( fout, bigEndian ) ;
+		ply.writeHeader( numVertices( ), numTriangles( ) ) ;
+		if ( ! vertices.empty( ) )
+			ply.writeVertices( &vertices[0], numVertices( ) ) ;
+		if ( ! triangles.empty( ) )
+			ply.writeTriangles( (const int*) &triangles[0], numTriangles( ) ) ;
+		ply.flush( ) ;
+		fclose( fout ) ;
+		return 1 ;
+	};
+};
+
+#endif
@@ -0,0 +1,130 @@
+/*
+
+  Block allocator for octree nodes.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public License
+  (LGPL) as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef NODEARENA_H
+#define NODEARENA_H
+
+#include <stdlib.h>
+#include <new>
+#include <vector>
+
+// Nodes are carved out of large blocks and never freed one by one.
+// Dropping the arena frees every node it handed out at once, without
+// running destructors, so nodes placed here must not own other memory.
+// Nodes given back with recycle() are kept on a free list per size
+// and handed out again by the next alloc() of the same size.
+// An arena is not thread-safe, use one per thread.
+class NodeArena {
+	enum { ALIGN = 8, BLOCK_SIZE = 1 << 20, NUM_SIZES = 32 } ;
+
+	struct FreeNode {
+		FreeNode* next ;
+	};
+
+	std::vector<char*> blocks ;
+	char* cur ;          // next free byte of the current block
+	size_t left ;        // bytes left in the current block
+	FreeNode* freeList[ NUM_SIZES ] ; // recycled nodes, by size / ALIGN
+
+	static size_t roundUp( size_t n ) {
+		return ( n + ALIGN - 1 ) & ~( (size_t) ALIGN - 1 ) ;
+	};
+
+public:
+	// statistics
+	size_t blockBytes ;  // bytes obtained from malloc
+	size_t usedBytes ;   // bytes handed out and not recycled
+	size_t numAllocs ;   // nodes handed out, including reused ones
+	size_t numRecycled ; // nodes given back with recycle()
+	size_t numReused ;   // allocations served from a free list
+
+	NodeArena( ) {
+		cur = NULL ;
+		left = 0 ;
+		for ( int i = 0 ; i < NUM_SIZES ; i ++ )
+			freeList[i] = NULL ;
+		blockBytes = usedBytes = numAllocs = numRecycled = numReused = 0 ;
+	};
+	~NodeArena( ) {
+		release( ) ;
+	};
+
+	void* alloc( size_t n ) {
+		n = roundUp( n ) ;
+		numAllocs ++ ;
+		usedBytes += n ;
+		size_t sc = n / ALIGN ;
+		if ( sc < NUM_SIZES && freeList[ sc ] != NULL ) {
+			FreeNode* f = freeList[ sc ] ;
+			freeList[ sc ] = f->next ;
+			numReused ++ ;
+			return f ;
+		}
+		if ( n > left ) {
+			size_t bs = n > BLOCK_SIZE ? n : BLOCK_SIZE ;
+			cur = (char*) malloc( bs ) ;
+			if ( cur == NULL )
+				throw std::bad_alloc( ) ;
+			blocks.push_back( cur ) ;
+			blockBytes += bs ;
+			left = bs ;
+		}
+		void* p = cur ;
+		cur += n ;
+		left -= n ;
+		return p ;
+	};
+
+	/// Give a node back for reuse, it is not destructed
+	void recycle( void* p, size_t n ) {
+		n = roundUp( n ) ;
+		usedBytes -= n ;
+		numRecycled ++ ;
+		size_t sc = n / ALIGN ;
+		if ( sc < NUM_SIZES ) {
+			FreeNode* f = (FreeNode*) p ;
+			f->next = freeList[ sc ] ;
+			freeList[ sc ] = f ;
+		}
+	};
+
+	/// Construct a T in the arena
+	template <class T, class... Args>
+	T* make( Args&&... args ) {
+		return new ( alloc( sizeof( T ) ) ) T( args... ) ;
+	};
+
+	/// Free all blocks at once
+	void release( ) {
+		for ( size_t i = 0 ; i < blocks.size( ) ; i ++ )
+			free( blocks[i] ) ;
+		blocks.clear( ) ;
+		cur = NULL ;
+		left = 0 ;
+		for ( int i = 0 ; i < NUM_SIZES ; i ++ )
+			freeList[i] = NULL ;
+		blockBytes = usedBytes = 0 ;
+	};
+
+private:
+	NodeArena( const NodeArena& ) ;
+	NodeArena& operator=( const NodeArena& ) ;
+};
+
+#endif
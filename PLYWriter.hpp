@@ -1,93 +1,229 @@
-/*
-
-  Static class for writing PLY files.
-
-  Copyright (C) 2011  Tao Ju
-
-  This library is free software; you can redistribute it and/or
-  modify it under the terms of the GNU Lesser General Public License
-  (LGPL) as published by the Free Software Foundation; either
-  version 2.1 of the License, or (at your option) any later version.
-
-  This library is distributed in the hope that it will be useful,
-  but WITHOUT ANY WARRANTY; without even the implied warranty of
-  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
-  Lesser General Public License for more details.
-
-  You should have received a copy of the GNU Lesser General Public
-  License along with this library; if not, write to the Free Software
-  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
-*/
-
-#ifndef PLYWRITER_H
-#define PLYWRITER_H
-
-class PLYWriter {
-public:
-	/// Constructor
-	PLYWriter( ) { };
-
-	/// Write ply header
-	static void writeHeader ( FILE* fout, int numVert, int numFace ) {
-		// Ply
-		fprintf( fout, "ply\n" ) ;
-
-		// Always big endian
-		fprintf( fout, "format binary_big_endian 1.0\n" ) ;
-
-		// vertex properties
-		fprintf( fout, "element vertex %d\n", numVert ) ;
-		fprintf( fout, "property float x\n" ) ;
-		fprintf( fout, "property float y\n" ) ;
-		fprintf( fout, "property float z\n" ) ;
-
-		// face properties
-		fprintf( fout, "element face %d\n", numFace ) ;
-		fprintf( fout, "property list uchar int vertex_indices\n" ) ;
-
-		// End
-		fprintf( fout, "end_header\n" ) ;
-	};
-    // data written below is not ascii, but binary!
-    
-	/// Write vertex
-	static void writeVertex ( FILE* fout, float vt[3] )
-	{
-		float nvt[3] ;
-		for ( int i = 0 ; i < 3 ; i ++ )
-		{
-			nvt[i] = vt[i] ;
-			flipBits32( &(nvt[i]) ) ;
-		}
-		fwrite( nvt, sizeof ( float ), 3, fout ) ;
-	};
-
-	/// Write face
-	static void writeFace ( FILE* fout, int num, int fc[] )
-	{
-		unsigned char cnum = num ;
-		fwrite( &cnum, sizeof( unsigned char ), 1, fout ) ;
-		for ( int i = 0 ; i < num ; i ++ )
-		{
-			flipBits32( &(fc[i]) ) ;
-		}
-		fwrite( fc, sizeof ( int ), num, fout ) ;
-	};
-
-	static void flipBits32 ( void *x )
-	{
-		unsigned char *temp = (unsigned char *)x;
-		unsigned char swap;
-		
-		swap = temp [ 0 ];
-		temp [ 0 ] = temp [ 3 ];
-		temp [ 3 ] = swap;
-
-		swap = temp [ 1 ];
-		temp [ 1 ] = temp [ 2 ];
-		temp [ 2 ] = swap;
-	};
-
-};
-
-#endif
+/*
+
+  Static class for writing PLY files.
+
+  Copyright (C) 2011  Tao Ju
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public License
+  (LGPL) as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef PLYWRITER_H
+#define PLYWRITER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// byte order of this machine, binary PLY files in the same order need no swapping
+#if defined( __BYTE_ORDER__ ) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define PLY_HOST_BIG_ENDIAN 1
+#else
+#define PLY_HOST_BIG_ENDIAN 0
+#endif
+
+class PLYWriter {
+public:
+	/// Constructor
+	PLYWriter( ) { };
+
+	/// Write ply header
+	static void writeHeader ( FILE* fout, int numVert, int numFace, int bigEndian = 1 ) {
+		// Ply
+		fprintf( fout, "ply\n" ) ;
+
+		// big endian unless asked otherwise
+		fprintf( fout, "format %s 1.0\n", bigEndian ? "binary_big_endian" : "binary_little_endian" ) ;
+
+		// vertex properties
+		fprintf( fout, "element vertex %d\n", numVert ) ;
+		fprintf( fout, "property float x\n" ) ;
+		fprintf( fout, "property float y\n" ) ;
+		fprintf( fout, "property float z\n" ) ;
+
+		// face properties
+		fprintf( fout, "element face %d\n", numFace ) ;
+		fprintf( fout, "property list uchar int vertex_indices\n" ) ;
+
+		// End
+		fprintf( fout, "end_header\n" ) ;
+	};
+    // data written below is not ascii, but binary!
+    
+	/// Write vertex
+	static void writeVertex ( FILE* fout, float vt[3] )
+	{
+		float nvt[3] ;
+		for ( int i = 0 ; i < 3 ; i ++ )
+		{
+			nvt[i] = vt[i] ;
+			flipBits32( &(nvt[i]) ) ;
+		}
+		fwrite( nvt, sizeof ( float ), 3, fout ) ;
+	};
+
+	/// Write face, at most 255 vertices
+	static void writeFace ( FILE* fout, int num, const int fc[] )
+	{
+		unsigned char cnum = num ;
+		fwrite( &cnum, sizeof( unsigned char ), 1, fout ) ;
+		int nfc[255] ;
+		for ( int i = 0 ; i < num ; i ++ )
+		{
+			nfc[i] = fc[i] ;
+			flipBits32( &(nfc[i]) ) ;
+		}
+		fwrite( nfc, sizeof ( int ), num, fout ) ;
+	};
+
+	static void flipBits32 ( void *x )
+	{
+		unsigned char *temp = (unsigned char *)x;
+		unsigned char swap;
+		
+		swap = temp [ 0 ];
+		temp [ 0 ] = temp [ 3 ];
+		temp [ 3 ] = swap;
+
+		swap = temp [ 1 ];
+		temp [ 1 ] = temp [ 2 ];
+		temp [ 2 ] = swap;
+	};
+
+	/// Flip n 32-bit values starting at x, which need not be aligned
+	static void flipBits32 ( void *x, size_t n )
+	{
+		unsigned char *temp = (unsigned char *)x;
+		size_t i = 0 ;
+#ifdef __SSE2__
+		for ( ; i + 4 <= n ; i += 4 )
+		{
+			__m128i v = _mm_loadu_si128( (__m128i*) ( temp + 4 * i ) ) ;
+			// swap the bytes of each 16-bit half, then the two halves
+			v = _mm_or_si128( _mm_slli_epi16( v, 8 ), _mm_srli_epi16( v, 8 ) ) ;
+			v = _mm_shufflelo_epi16( v, _MM_SHUFFLE( 2, 3, 0, 1 ) ) ;
+			v = _mm_shufflehi_epi16( v, _MM_SHUFFLE( 2, 3, 0, 1 ) ) ;
+			_mm_storeu_si128( (__m128i*) ( temp + 4 * i ), v ) ;
+		}
+#endif
+		for ( ; i < n ; i ++ )
+			flipBits32( temp + 4 * i ) ;
+	};
+
+};
+
+// Buffered binary PLY output. Vertices and faces are collected in a large
+// buffer that goes out with one fwrite() when it is full, and values are
+// only byte-swapped, a whole block at a time, when the byte order of the
+// file is not the one of this machine.
+class PLYStream {
+public:
+	enum { BUFFER_SIZE = 1 << 22, TRI_BLOCK = 1024 } ;
+
+	PLYStream( FILE* f, int bigEnd = 1 ) {
+		fout = f ;
+		bigEndian = bigEnd ;
+		swap = bigEndian != PLY_HOST_BIG_ENDIAN ;
+		buf = (char*) malloc( BUFFER_SIZE ) ;
+		if ( buf == NULL )
+			throw std::bad_alloc( ) ;
+		used = 0 ;
+	};
+	~PLYStream( ) {
+		flush( ) ;
+		free( buf ) ;
+	};
+
+	/// Write the header at the current position of the file, after what is buffered
+	void writeHeader( int numVert, int numFace ) {
+		flush( ) ;
+		PLYWriter::writeHeader( fout, numVert, numFace, bigEndian ) ;
+	};
+
+	/// Write n vertices, 3 floats each
+	void writeVertices( const float* vt, int n ) {
+		while ( n > 0 ) {
+			if ( used + 3 * sizeof( float ) > BUFFER_SIZE )
+				flush( ) ;
+			int k = (int) ( ( BUFFER_SIZE - used ) / ( 3 * sizeof( float ) ) ) ;
+			if ( k > n )
+				k = n ;
+			memcpy( buf + used, vt, 3 * sizeof( float ) * k ) ;
+			if ( swap )
+				PLYWriter::flipBits32( buf + used, 3 * k ) ;
+			used += 3 * sizeof( float ) * k ;
+			vt += 3 * k ;
+			n -= k ;
+		}
+	};
+	void writeVertex( const float vt[3] ) { writeVertices( vt, 1 ) ; } ;
+
+	/// Write n triangles, 3 indices each
+	void writeTriangles( const int* ind, int n ) {
+		const size_t rec = 1 + 3 * sizeof( int ) ;
+		int tmp[ 3 * TRI_BLOCK ] ;
+		while ( n > 0 ) {
+			int k = n < TRI_BLOCK ? n : TRI_BLOCK ;
+			memcpy( tmp, ind, 3 * sizeof( int ) * k ) ;
+			if ( swap )
+				PLYWriter::flipBits32( tmp, 3 * k ) ;
+			if ( used + rec * k > BUFFER_SIZE )
+				flush( ) ;
+			char* p = buf + used ;
+			for ( int i = 0 ; i < k ; i ++ ) {
+				p[0] = 3 ;
+				memcpy( p + 1, tmp + 3 * i, 3 * sizeof( int ) ) ;
+				p += rec ;
+			}
+			used += rec * k ;
+			ind += 3 * k ;
+			n -= k ;
+		}
+	};
+
+	/// Write a face of num vertices, at most 255
+	void writeFace( int num, const int fc[] ) {
+		size_t len = 1 + sizeof( int ) * num ;
+		if ( used + len > BUFFER_SIZE )
+			flush( ) ;
+		buf[ used ] = (unsigned char) num ;
+		memcpy( buf + used + 1, fc, sizeof( int ) * num ) ;
+		if ( swap )
+			PLYWriter::flipBits32( buf + used + 1, num ) ;
+		used += len ;
+	};
+
+	/// Hand everything buffered to the file
+	void flush( ) {
+		if ( used > 0 )
+			fwrite( buf, 1, used, fout ) ;
+		used = 0 ;
+	};
+
+private:
+	FILE* fout ;
+	int bigEndian ;
+	int swap ;  // the file is not in the byte order of this machine
+	char* buf ;
+	size_t used ;
+
+	PLYStream( const PLYStream& ) ;
+	PLYStream& operator=( const PLYStream& ) ;
+};
+
+#endif
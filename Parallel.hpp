@@ -0,0 +1,180 @@
+/*
+
+  Minimal helpers for running independent work items and fork-join
+  tasks on several threads.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public License
+  (LGPL) as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class Parallel {
+public:
+	/// Number of threads to use, requested <= 0 means one per core
+	static int numThreads( int requested ) {
+		if ( requested > 0 )
+			return requested ;
+		int n = (int) std::thread::hardware_concurrency( ) ;
+		return n > 0 ? n : 1 ;
+	};
+
+	/// Wall-clock time in seconds, clock() adds up the time of all threads
+	static double wallTime( ) {
+		return std::chrono::duration<double>( std::chrono::steady_clock::now( ).time_since_epoch( ) ).count( ) ;
+	};
+
+	/// Run f( item, worker ) for every item in [0, n) on nthreads threads.
+	/// Items are handed out one at a time, so uneven items balance out.
+	/// worker is in [0, nthreads) and can index per-thread storage.
+	/// The calling thread is worker 0.
+	template <class F>
+	static void parallelFor( int n, int nthreads, F f ) {
+		if ( nthreads > n )
+			nthreads = n ;
+		if ( nthreads <= 1 ) {
+			for ( int i = 0 ; i < n ; i ++ )
+				f( i, 0 ) ;
+			return ;
+		}
+
+		std::atomic<int> next( 0 ) ;
+		auto work = [&]( int worker ) {
+			int i ;
+			while ( ( i = next.fetch_add( 1 ) ) < n )
+				f( i, worker ) ;
+		};
+
+		std::vector<std::thread> threads ;
+		for ( int t = 1 ; t < nthreads ; t ++ )
+			threads.push_back( std::thread( work, t ) ) ;
+		work( 0 ) ;
+		for ( size_t t = 0 ; t < threads.size( ) ; t ++ )
+			threads[t].join( ) ;
+	};
+};
+
+// Fork-join tasks with work stealing, for recursions whose branches are
+// independent until their parent combines them.
+// Each worker has its own deque: it adds and takes tasks at the back,
+// idle workers steal from the front of the others, which is where the
+// biggest subtrees are. A task that waits for the tasks it spawned runs
+// other tasks meanwhile, so no thread blocks.
+class TaskPool {
+public:
+	typedef std::function<void( int )> Task ; // called with the worker that runs it
+
+	/// Tasks spawned together, wait() returns when all of them are done
+	struct Group {
+		std::atomic<int> left ;
+		Group( ) : left( 0 ) { } ;
+	};
+
+	// statistics
+	std::atomic<long> numTasks, numStolen ;
+
+	/// Run root( pool, 0 ) on the calling thread with nthreads - 1 helpers,
+	/// return when root is done. root must wait() for the tasks it spawns.
+	template <class F>
+	static void run( int nthreads, F root, long* tasks = NULL, long* stolen = NULL ) {
+		TaskPool pool( nthreads ) ;
+		std::vector<std::thread> threads ;
+		for ( int t = 1 ; t < nthreads ; t ++ )
+			threads.push_back( std::thread( [&pool, t]( ) { pool.help( t ) ; } ) ) ;
+		root( pool, 0 ) ;
+		pool.done = 1 ;
+		for ( size_t t = 0 ; t < threads.size( ) ; t ++ )
+			threads[t].join( ) ;
+		if ( tasks != NULL )
+			*tasks = pool.numTasks ;
+		if ( stolen != NULL )
+			*stolen = pool.numStolen ;
+	};
+
+	/// Queue t on worker as part of g
+	void spawn( int worker, Group& g, Task t ) {
+		g.left ++ ;
+		numTasks ++ ;
+		Queue& q = queues[ worker ] ;
+		std::lock_guard<std::mutex> guard( q.lock ) ;
+		q.tasks.push_back( Entry( t, &g ) ) ;
+	};
+
+	/// Run tasks on worker until everything in g is done
+	void wait( int worker, Group& g ) {
+		while ( g.left > 0 ) {
+			if ( ! runOne( worker ) )
+				std::this_thread::yield( ) ;
+		}
+	};
+
+private:
+	typedef std::pair<Task, Group*> Entry ;
+	struct Queue {
+		std::mutex lock ;
+		std::deque<Entry> tasks ;
+	};
+
+	std::vector<Queue> queues ; // one per worker
+	std::atomic<int> done ;
+
+	TaskPool( int nthreads ) : numTasks( 0 ), numStolen( 0 ), queues( nthreads ), done( 0 ) { } ;
+
+	// take a task from the back of our own deque or the front of another one and run it
+	bool runOne( int worker ) {
+		Entry e ;
+		bool found = false ;
+		int n = (int) queues.size( ) ;
+		for ( int k = 0 ; k < n && ! found ; k ++ ) {
+			Queue& q = queues[ ( worker + k ) % n ] ;
+			std::lock_guard<std::mutex> guard( q.lock ) ;
+			if ( q.tasks.empty( ) )
+				continue ;
+			if ( k == 0 ) {
+				e = q.tasks.back( ) ;
+				q.tasks.pop_back( ) ;
+			}
+			else {
+				e = q.tasks.front( ) ;
+				q.tasks.pop_front( ) ;
+				numStolen ++ ;
+			}
+			found = true ;
+		}
+		if ( ! found )
+			return false ;
+		e.first( worker ) ;
+		e.second->left -- ;
+		return true ;
+	};
+
+	// helper threads run tasks until run() is done
+	void help( int worker ) {
+		while ( ! done ) {
+			if ( ! runOne( worker ) )
+				std::this_thread::yield( ) ;
+		}
+	};
+};
+
+#endif
@@ -0,0 +1,184 @@
+/*
+
+  Structure-of-arrays storage for the QEFs of octree leaves.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public License
+  (LGPL) as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef QEFPOOL_H
+#define QEFPOOL_H
+
+#include <stdlib.h>
+#include <mutex>
+#include <new>
+#include <vector>
+
+// QEF accumulators of one leaf or pseudo-leaf, as passed around by value.
+// In the pool the same fields are stored as separate arrays.
+struct QEFData {
+	float ata[6], atb[3], btb ;
+
+	QEFData( ) {
+		for ( int i = 0 ; i < 6 ; i ++ )
+			ata[i] = 0 ;
+		for ( int i = 0 ; i < 3 ; i ++ )
+			atb[i] = 0 ;
+		btb = 0 ;
+	};
+	QEFData( float ata1[6], float atb1[3], float btb1 ) {
+		for ( int i = 0 ; i < 6 ; i ++ )
+			ata[i] = ata1[i] ;
+		for ( int i = 0 ; i < 3 ; i ++ )
+			atb[i] = atb1[i] ;
+		btb = btb1 ;
+	};
+};
+
+// QEFs are only needed until the tree is simplified, so they are kept out
+// of the nodes. A node stores a 32-bit handle into the pool, and the whole
+// pool can be dropped with release() before contouring.
+// Storage comes in chunks of CHUNK_SIZE entries, with every field in its
+// own array. Each thread fills chunks through its own Cursor, the lock is
+// only taken to get a new chunk. Chunks never move, so entries can be read
+// while other threads add to the pool.
+class QEFPool {
+public:
+	enum { CHUNK_BITS = 14, CHUNK_SIZE = 1 << CHUNK_BITS, MAX_CHUNKS = 1 << ( 32 - CHUNK_BITS ) } ;
+	static const unsigned int NONE = 0xFFFFFFFFu ; // no QEF
+
+	struct Chunk {
+		float ata[6][ CHUNK_SIZE ] ;
+		float atb[3][ CHUNK_SIZE ] ;
+		float btb[ CHUNK_SIZE ] ;
+	};
+
+	// Where one thread adds entries: the rest of its current chunk,
+	// and the handles it was given back with recycle()
+	struct Cursor {
+		Chunk* chunk ;
+		unsigned int base, used ;
+		std::vector<unsigned int> freed ;
+
+		Cursor( ) {
+			chunk = NULL ;
+			base = 0 ;
+			used = CHUNK_SIZE ;
+		};
+	};
+
+private:
+	Chunk** table ;      // MAX_CHUNKS slots, only the first numChunks are set
+	unsigned int numChunks ;
+	std::mutex lock ;
+
+	Chunk* chunkOf( unsigned int h ) { return table[ h >> CHUNK_BITS ] ; } ;
+	static unsigned int slotOf( unsigned int h ) { return h & ( CHUNK_SIZE - 1 ) ; } ;
+
+	void newChunk( Cursor& c ) {
+		Chunk* chunk = (Chunk*) malloc( sizeof( Chunk ) ) ;
+		if ( chunk == NULL )
+			throw std::bad_alloc( ) ;
+		std::lock_guard<std::mutex> guard( lock ) ;
+		if ( table == NULL ) {
+			// calloc leaves the pages of unused slots untouched
+			table = (Chunk**) calloc( MAX_CHUNKS, sizeof( Chunk* ) ) ;
+			if ( table == NULL )
+				throw std::bad_alloc( ) ;
+		}
+		if ( numChunks == MAX_CHUNKS )
+			throw std::bad_alloc( ) ;
+		table[ numChunks ] = chunk ;
+		c.chunk = chunk ;
+		c.base = numChunks << CHUNK_BITS ;
+		c.used = 0 ;
+		numChunks ++ ;
+	};
+
+public:
+	// statistics
+	size_t releasedBytes ; // bytes freed by release()
+
+	QEFPool( ) {
+		table = NULL ;
+		numChunks = 0 ;
+		releasedBytes = 0 ;
+	};
+	~QEFPool( ) {
+		release( ) ;
+		free( table ) ;
+	};
+
+	/// Add an entry through cursor c and return its handle
+	unsigned int store( Cursor& c, const QEFData& q ) {
+		unsigned int h ;
+		Chunk* chunk ;
+		if ( ! c.freed.empty( ) ) {
+			h = c.freed.back( ) ;
+			c.freed.pop_back( ) ;
+			chunk = chunkOf( h ) ;
+		}
+		else {
+			if ( c.used == CHUNK_SIZE )
+				newChunk( c ) ;
+			h = c.base + c.used ++ ;
+			chunk = c.chunk ;
+		}
+		unsigned int s = slotOf( h ) ;
+		for ( int i = 0 ; i < 6 ; i ++ )
+			chunk->ata[i][s] = q.ata[i] ;
+		for ( int i = 0 ; i < 3 ; i ++ )
+			chunk->atb[i][s] = q.atb[i] ;
+		chunk->btb[s] = q.btb ;
+		return h ;
+	};
+
+	/// Entry h, which must not have been released
+	QEFData get( unsigned int h ) {
+		QEFData q ;
+		Chunk* chunk = chunkOf( h ) ;
+		unsigned int s = slotOf( h ) ;
+		for ( int i = 0 ; i < 6 ; i ++ )
+			q.ata[i] = chunk->ata[i][s] ;
+		for ( int i = 0 ; i < 3 ; i ++ )
+			q.atb[i] = chunk->atb[i][s] ;
+		q.btb = chunk->btb[s] ;
+		return q ;
+	};
+
+	/// Hand entry h to cursor c for reuse by its next store()
+	void recycle( Cursor& c, unsigned int h ) {
+		c.freed.push_back( h ) ;
+	};
+
+	/// Bytes held by the chunks
+	size_t bytes( ) { return (size_t) numChunks * sizeof( Chunk ) ; } ;
+
+	/// Free all chunks. Handles given out before are no longer valid,
+	/// cursors must be reset before they are used again.
+	void release( ) {
+		releasedBytes += bytes( ) ;
+		for ( unsigned int i = 0 ; i < numChunks ; i ++ ) {
+			free( table[i] ) ;
+			table[i] = NULL ;
+		}
+		numChunks = 0 ;
+	};
+
+private:
+	QEFPool( const QEFPool& ) ;
+	QEFPool& operator=( const QEFPool& ) ;
+};
+
+#endif
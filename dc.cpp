@@ -1,83 +1,234 @@
-/*
-  Copyright (C) 2011 Tao Ju
-
-  This library is free software; you can redistribute it and/or
-  modify it under the terms of the GNU Lesser General Public License
-  (LGPL) as published by the Free Software Foundation; either
-  version 2.1 of the License, or (at your option) any later version.
-
-  This library is distributed in the hope that it will be useful,
-  but WITHOUT ANY WARRANTY; without even the implied warranty of
-  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
-  Lesser General Public License for more details.
-
-  You should have received a copy of the GNU Lesser General Public
-  License along with this library; if not, write to the Free Software
-  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
-*/
-#include "octree.hpp"
-#include "PLYReader.hpp"
-#include "PLYWriter.hpp"
-#include "intersection.hpp"
-
-#include <math.h>
-#include <iostream>
-
-#include <boost/program_options.hpp>
-namespace po = boost::program_options;
-
-//#define ALLOW_INTERSECTION
-
-/*	Parameters
- *	argv[1]:	name of input file (.dcf format)
- *	argv[2]:	name of output file (.ply format)
- *	argv[3]:	(OPTIONAL) name of secondary output file (.ply format) 
- *              when using dual contouring, storing self-intersecting triangles.
-*/
-
-int main( int args, char* argv[] )
-{
-	// Declare the supported options.
-	po::options_description desc("Allowed options");
-	desc.add_options()
-		("help", "produce help message")
-		("simplify", po::value<float>(), "set simplify threshold (float)")
-		("nointer", "use intersection-free algorithm")
-		("test", "run intersection test")
-	;
-
-	po::variables_map vm;
-	po::store(po::parse_command_line(args, argv, desc), vm);
-	po::notify(vm);    
-
-	if (vm.count("help")) {
-		std::cout << desc << "\n";
-		return 1;
-	}
-	float simplify_threshold = -1;
-	if (vm.count("simplify")) {
-		simplify_threshold = vm["simplify"].as<float>();
-		std::cout << "Simplify threshold set: " << simplify_threshold << "\n";
-	} else {
-		std::cout << "Simplify not set.\n";
-	}
-
-	// Read input file
-	std::cout << " input file: " << argv[1] << "\n";
-	Octree* mytree = new Octree( argv[1], simplify_threshold ) ;
-
-	if (vm.count("nointer")) {
-		std::cout << "Intersection-free algorithm! [Ju et al. 2006] \n";
-		mytree->genContourNoInter2( argv[2] ) ;
-	} else {
-		std::cout << "Original algorithm! [Ju et al. 2002] \n";
-		mytree->genContour( argv[2] ) ;
-	}
-	
-	if (vm.count("test")) {
-		printf("Running intersection test... \n") ;
-		int num = Intersection::testIntersection( argv[2], argv[3] ); // Pairwise intersection test - may take a while
-		printf("%d intersections found!\n", num) ;
-	}
-}
-
+/*
+  Copyright (C) 2011 Tao Ju
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public License
+  (LGPL) as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+#include "octree.hpp"
+#include "LinearOctree.hpp"
+#include "PLYReader.hpp"
+#include "PLYWriter.hpp"
+#include "intersection.hpp"
+
+#include <limits.h>
+#include <math.h>
+#include <iostream>
+#include <string>
+
+#include <boost/program_options.hpp>
+namespace po = boost::program_options;
+
+//#define ALLOW_INTERSECTION
+
+/*	Parameters
+ *	argv[1]:	name of input file (.dcf format)
+ *	argv[2]:	name of output file (.ply format)
+ *	argv[3]:	(OPTIONAL) name of secondary output file (.ply format) 
+ *              when using dual contouring, storing self-intersecting triangles.
+*/
+
+// write the contour of tree to fname with the algorithm picked in vm,
+// the surface is also left in keep if it is not NULL
+static void contour( Octree* mytree, po::variables_map& vm, char* fname, Mesh* keep = NULL )
+{
+	if (vm.count("nointer")) {
+		std::cout << "Intersection-free algorithm! [Ju et al. 2006] \n";
+		if ( keep != NULL )
+			mytree->genMeshNoInter2( *keep ) ;
+		else
+			mytree->genContourNoInter2( fname ) ;
+	} else if (vm.count("linear")) {
+		std::cout << "Original algorithm! [Ju et al. 2002] on linear octree\n";
+		LinearOctree lintree( mytree ) ;
+		mytree->releaseQEF( ) ;
+		if ( keep != NULL )
+			lintree.genMesh( *keep ) ;
+		else
+			lintree.genContour( fname, ! vm.count("little-endian") ) ;
+	} else {
+		std::cout << "Original algorithm! [Ju et al. 2002] \n";
+		if ( keep != NULL )
+			mytree->genMesh( *keep ) ;
+		else
+			mytree->genContour( fname ) ;
+	}
+	if ( keep != NULL )
+		keep->writePLY( fname, ! vm.count("little-endian") ) ;
+}
+
+int main( int args, char* argv[] )
+{
+	// Declare the supported options.
+	po::options_description desc("Allowed options");
+	desc.add_options()
+		("help", "produce help message")
+		("simplify", po::value<float>(), "set simplify threshold (float)")
+		("thresholds", po::value< std::vector<float> >()->multitoken(), "simplify once for all these thresholds and write output-<threshold>.ply for each")
+		("target-vertices", po::value<int>(), "simplify until the output has at most this many vertices")
+		("target-triangles", po::value<int>(), "simplify until the output has about this many triangles or less")
+		("single-pass", "contour without counting first, the PLY header is filled in at the end")
+		("little-endian", "write binary_little_endian PLY files, no byte swapping on x86")
+		("contour-depth", po::value<int>(), "contour the subtrees this many levels below the root on --threads threads, 0 = serial (default 3)")
+		("nointer", "use intersection-free algorithm")
+		("test", "run intersection test")
+		("verify", "run intersection test on the mesh in memory, only between triangles of touching octree cells")
+		("mmap", "read the input file through mmap instead of fread")
+		("parallel-read", "decode subtrees of the input file on several threads (implies --mmap)")
+		("split-depth", po::value<int>(), "depth of the subtrees decoded in parallel (default 2)")
+		("threads", po::value<int>(), "number of worker threads (default one per core)")
+		("stream-simplify", "collapse nodes while reading, so the full-resolution tree is never in memory (implies --lazy-qef)")
+		("simplify-grain", po::value<int>(), "simplify the children of nodes at least this many cells wide as separate tasks (default 16)")
+		("linear", "contour on a pointer-free, Morton-ordered copy of the octree")
+		("no-recycle", "do not reuse the memory of nodes removed by simplification")
+		("no-batch-qef", "solve the QEF of each leaf on its own instead of in SIMD batches")
+		("lazy-qef", "only solve the QEFs of leaves that are left after --simplify")
+		("qef-solver", po::value<std::string>(), "minimizer method: inverse (default), descent, descent-fixed, hybrid or midpoint")
+		("to-dcf2", "convert the input .dcf into an indexed .dcf2 file (second argument) and exit")
+		("index-depth", po::value<int>(), "depth of the .dcf2 index table (default 3)")
+		("subtree", po::value< std::vector<int> >()->multitoken(), "only load these .dcf2 table entries")
+		("region", po::value< std::vector<int> >()->multitoken(), "only load .dcf2 subtrees touching the box x0 y0 z0 x1 y1 z1")
+	;
+
+	po::variables_map vm;
+	po::store(po::parse_command_line(args, argv, desc), vm);
+	po::notify(vm);    
+
+	if (vm.count("help")) {
+		std::cout << desc << "\n";
+		return 1;
+	}
+	float simplify_threshold = -1;
+	if (vm.count("simplify")) {
+		simplify_threshold = vm["simplify"].as<float>();
+		std::cout << "Simplify threshold set: " << simplify_threshold << "\n";
+	} else {
+		std::cout << "Simplify not set.\n";
+	}
+
+	if (vm.count("to-dcf2")) {
+		int indexDepth = 3 ;
+		if (vm.count("index-depth"))
+			indexDepth = vm["index-depth"].as<int>() ;
+		Octree::convertDCF2( argv[1], argv[2], indexDepth ) ;
+		return 0 ;
+	}
+
+	// Read input file
+	std::cout << " input file: " << argv[1] << "\n";
+	OctreeOptions opts ;
+	if (vm.count("mmap"))
+		opts.loader = DCF_MMAP ;
+	if (vm.count("parallel-read"))
+		opts.loader = DCF_PARALLEL ;
+	if (vm.count("split-depth"))
+		opts.splitDepth = vm["split-depth"].as<int>() ;
+	if (vm.count("threads"))
+		opts.numThreads = vm["threads"].as<int>() ;
+	if (vm.count("simplify-grain"))
+		opts.simplifyGrain = vm["simplify-grain"].as<int>() ;
+	if (vm.count("no-recycle"))
+		opts.recycleNodes = 0 ;
+	if (vm.count("no-batch-qef"))
+		opts.batchQEF = 0 ;
+	if (vm.count("single-pass"))
+		opts.singlePass = 1 ;
+	if (vm.count("little-endian"))
+		opts.littleEndianPLY = 1 ;
+	if (vm.count("contour-depth"))
+		opts.contourDepth = vm["contour-depth"].as<int>() ;
+	if (vm.count("stream-simplify"))
+		opts.streamSimplify = 1 ;
+	if (vm.count("lazy-qef"))
+		opts.lazyQEF = 1 ;
+	if (vm.count("qef-solver")) {
+		std::string solver = vm["qef-solver"].as<std::string>() ;
+		if ( solver == "inverse" )
+			opts.qefSolver = QEF_PSEUDO_INVERSE ;
+		else if ( solver == "descent" )
+			opts.qefSolver = QEF_DESCENT ;
+		else if ( solver == "descent-fixed" )
+			opts.qefSolver = QEF_DESCENT_FIXED ;
+		else if ( solver == "hybrid" )
+			opts.qefSolver = QEF_DESCENT_HYBRID ;
+		else if ( solver == "midpoint" )
+			opts.qefSolver = QEF_MIDPOINT ;
+		else {
+			std::cout << "Unknown QEF solver: " << solver << "\n";
+			return 1;
+		}
+	}
+	if (vm.count("subtree"))
+		opts.subtrees = vm["subtree"].as< std::vector<int> >() ;
+	if (vm.count("region")) {
+		std::vector<int> region = vm["region"].as< std::vector<int> >() ;
+		if ( region.size() != 6 ) {
+			std::cout << "--region needs six values: x0 y0 z0 x1 y1 z1\n" ;
+			return 1 ;
+		}
+		opts.hasRegion = 1 ;
+		for ( int i = 0 ; i < 6 ; i ++ )
+			opts.region[i] = region[i] ;
+	}
+	if (vm.count("thresholds")) {
+		// one collapse-error tree, then a cut and an output file per threshold
+		std::vector<float> thresholds = vm["thresholds"].as< std::vector<float> >() ;
+		Octree* mytree = new Octree( argv[1], -1, opts ) ;
+		mytree->buildCollapseTree( ) ;
+		std::string base = argv[2] ;
+		if ( base.size() > 4 && base.compare( base.size() - 4, 4, ".ply" ) == 0 )
+			base.resize( base.size() - 4 ) ;
+		for ( size_t i = 0 ; i < thresholds.size() ; i ++ ) {
+			char name[1024] ;
+			snprintf( name, sizeof( name ), "%s-%g.ply", base.c_str(), thresholds[i] ) ;
+			mytree->cutCollapseTree( thresholds[i] ) ;
+			contour( mytree, vm, name ) ;
+		}
+		delete mytree ;
+		return 0 ;
+	}
+
+	if (vm.count("target-vertices") || vm.count("target-triangles")) {
+		// collapse the cheapest nodes until the output fits the budget
+		int maxVertices = INT_MAX, maxTriangles = INT_MAX ;
+		if (vm.count("target-vertices"))
+			maxVertices = vm["target-vertices"].as<int>() ;
+		if (vm.count("target-triangles"))
+			maxTriangles = vm["target-triangles"].as<int>() ;
+		Octree* mytree = new Octree( argv[1], -1, opts ) ;
+		mytree->buildCollapseTree( ) ;
+		mytree->cutToBudget( maxVertices, maxTriangles ) ;
+		contour( mytree, vm, argv[2] ) ;
+		delete mytree ;
+		return 0 ;
+	}
+
+	Octree* mytree = new Octree( argv[1], simplify_threshold, opts ) ;
+	Mesh mesh ;
+	contour( mytree, vm, argv[2], vm.count("verify") ? &mesh : NULL ) ;
+
+	if (vm.count("verify")) {
+		printf("Running intersection test in memory... \n") ;
+		int num = mytree->verifyMesh( mesh, argv[3] ) ;
+		printf("%d intersections found!\n", num) ;
+	}
+	
+	if (vm.count("test")) {
+		printf("Running intersection test... \n") ;
+		int num = Intersection::testIntersection( argv[2], argv[3], opts.numThreads ) ;
+		printf("%d intersections found!\n", num) ;
+	}
+
+	delete mytree ;
+}
+
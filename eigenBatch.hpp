@@ -0,0 +1,195 @@
+/*
+
+  Batched QEF minimizers, the kernel shared by the scalar, AVX2 and
+  AVX-512 versions of calcPointBatch().
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public License
+  (LGPL) as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+// Included once by each of eigen.cpp, eigenBatchAVX2.cpp and eigenBatchAVX512.cpp,
+// which are compiled with different instruction sets. Everything is in an
+// unnamed namespace so the copies never get merged by the linker, and no
+// other header is included here for the same reason.
+//
+// S is a lane type with:
+//   typedef V (vector of WIDTH floats), M (mask)
+//   load( p ), store( p, v ), set( f )
+//   add, sub, mul, div, sqrt, abs, neg
+//   lt( a, b ), le( a, b ), eq( a, b ) -> M
+//   select( m, a, b ) -> a where m is set, b elsewhere
+//   andMask( m1, m2 )
+
+#ifndef EIGENBATCH_H
+#define EIGENBATCH_H
+
+namespace {
+
+// Cyclic Jacobi sweeps of the batch solver. A 3x3 matrix is diagonal to
+// float precision after 3, the last one is margin.
+const int BATCH_SWEEPS = 4 ;
+
+// one Jacobi rotation in the (p,q) plane of a[][] and the eigenvectors v[][] (columns)
+template <class S>
+inline void batchRotate( typename S::V a[3][3], typename S::V v[3][3], int p, int q )
+{
+	typedef typename S::V V ;
+	V zero = S::set( 0.0f ), one = S::set( 1.0f ) ;
+	V apq = a[p][q] ;
+
+	// t = sign(tau) / ( |tau| + sqrt( 1 + tau^2 ) ), the smaller root of t^2 + 2 tau t - 1 = 0
+	V tau = S::div( S::sub( a[q][q], a[p][p] ), S::mul( S::set( 2.0f ), apq ) ) ;
+	V t = S::div( one, S::add( S::abs( tau ), S::sqrt( S::add( one, S::mul( tau, tau ) ) ) ) ) ;
+	t = S::select( S::lt( tau, zero ), S::neg( t ), t ) ;
+	// nothing to do where apq is already zero, tau is inf or nan there
+	t = S::select( S::eq( apq, zero ), zero, t ) ;
+	V c = S::div( one, S::sqrt( S::add( one, S::mul( t, t ) ) ) ) ;
+	V s = S::mul( t, c ) ;
+
+	for ( int k = 0 ; k < 3 ; k ++ ) { // columns p and q
+		V akp = a[k][p], akq = a[k][q] ;
+		a[k][p] = S::sub( S::mul( c, akp ), S::mul( s, akq ) ) ;
+		a[k][q] = S::add( S::mul( s, akp ), S::mul( c, akq ) ) ;
+		V vkp = v[k][p], vkq = v[k][q] ;
+		v[k][p] = S::sub( S::mul( c, vkp ), S::mul( s, vkq ) ) ;
+		v[k][q] = S::add( S::mul( s, vkp ), S::mul( c, vkq ) ) ;
+	}
+	for ( int k = 0 ; k < 3 ; k ++ ) { // rows p and q
+		V apk = a[p][k], aqk = a[q][k] ;
+		a[p][k] = S::sub( S::mul( c, apk ), S::mul( s, aqk ) ) ;
+		a[q][k] = S::add( S::mul( s, apk ), S::mul( c, aqk ) ) ;
+	}
+	a[p][q] = zero ;
+	a[q][p] = zero ;
+}
+
+// WIDTH QEFs starting at entry i, same math as calcPoint() with QEF_PSEUDO_INVERSE
+template <class S>
+inline void batchSolve( int i, const float* const ata[6], const float* const atb[3], const float* btb,
+	const float* const midpoint[3], float* const rvalue[3], float* error )
+{
+	typedef typename S::V V ;
+	typedef typename S::M M ;
+	V zero = S::set( 0.0f ), one = S::set( 1.0f ) ;
+
+	V A[3][3], a[3][3], v[3][3], b[3], mid[3] ;
+	A[0][0] = S::load( ata[0] + i ) ;
+	A[0][1] = A[1][0] = S::load( ata[1] + i ) ;
+	A[0][2] = A[2][0] = S::load( ata[2] + i ) ;
+	A[1][1] = S::load( ata[3] + i ) ;
+	A[1][2] = A[2][1] = S::load( ata[4] + i ) ;
+	A[2][2] = S::load( ata[5] + i ) ;
+	for ( int j = 0 ; j < 3 ; j ++ ) {
+		b[j] = S::load( atb[j] + i ) ;
+		mid[j] = S::load( midpoint[j] + i ) ;
+		for ( int k = 0 ; k < 3 ; k ++ ) {
+			a[j][k] = A[j][k] ;
+			v[j][k] = j == k ? one : zero ;
+		}
+	}
+
+	// eigenvalues end up on the diagonal of a, eigenvectors in the columns of v
+	for ( int sweep = 0 ; sweep < BATCH_SWEEPS ; sweep ++ ) {
+		batchRotate<S>( a, v, 0, 1 ) ;
+		batchRotate<S>( a, v, 0, 2 ) ;
+		batchRotate<S>( a, v, 1, 2 ) ;
+	}
+
+	// pseudo-inverse as in matInverse(): the eigenvalue of largest modulus is
+	// always inverted, the others are dropped below 0.001
+	V d[3] = { a[0][0], a[1][1], a[2][2] } ;
+	V m[3] = { S::abs( d[0] ), S::abs( d[1] ), S::abs( d[2] ) } ;
+	M isMax[3] ;
+	isMax[0] = S::andMask( S::le( m[1], m[0] ), S::le( m[2], m[0] ) ) ;
+	isMax[1] = S::andMask( S::lt( m[0], m[1] ), S::le( m[2], m[1] ) ) ;
+	isMax[2] = S::andMask( S::lt( m[0], m[2] ), S::lt( m[1], m[2] ) ) ;
+	V w[3] ;
+	for ( int k = 0 ; k < 3 ; k ++ ) {
+		V inv = S::div( one, d[k] ) ;
+		V kept = S::select( S::lt( d[k], S::set( 0.001f ) ), zero, inv ) ;
+		V largest = S::select( S::eq( d[k], zero ), zero, inv ) ;
+		w[k] = S::select( isMax[k], largest, kept ) ;
+	}
+
+	// rvalue = midpoint + inv * ( b - A midpoint )
+	V newB[3] ;
+	for ( int j = 0 ; j < 3 ; j ++ ) {
+		newB[j] = b[j] ;
+		for ( int k = 0 ; k < 3 ; k ++ )
+			newB[j] = S::sub( newB[j], S::mul( A[j][k], mid[k] ) ) ;
+	}
+	V proj[3] ; // w_k * ( v_k . newB )
+	for ( int k = 0 ; k < 3 ; k ++ ) {
+		V dot = S::mul( v[0][k], newB[0] ) ;
+		dot = S::add( dot, S::mul( v[1][k], newB[1] ) ) ;
+		dot = S::add( dot, S::mul( v[2][k], newB[2] ) ) ;
+		proj[k] = S::mul( w[k], dot ) ;
+	}
+	V r[3] ;
+	for ( int j = 0 ; j < 3 ; j ++ ) {
+		r[j] = mid[j] ;
+		for ( int k = 0 ; k < 3 ; k ++ )
+			r[j] = S::add( r[j], S::mul( v[j][k], proj[k] ) ) ;
+		S::store( rvalue[j] + i, r[j] ) ;
+	}
+
+	// calcError()
+	V err = S::load( btb + i ) ;
+	V rb = S::add( S::add( S::mul( r[0], b[0] ), S::mul( r[1], b[1] ) ), S::mul( r[2], b[2] ) ) ;
+	err = S::sub( err, S::mul( S::set( 2.0f ), rb ) ) ;
+	for ( int j = 0 ; j < 3 ; j ++ ) {
+		V Ar = S::add( S::add( S::mul( A[j][0], r[0] ), S::mul( A[j][1], r[1] ) ), S::mul( A[j][2], r[2] ) ) ;
+		err = S::add( err, S::mul( r[j], Ar ) ) ;
+	}
+	S::store( error + i, err ) ;
+}
+
+// all n QEFs, the last partial group of lanes goes through a zero-padded copy
+template <class S>
+void batchSolveAll( int n, const float* const ata[6], const float* const atb[3], const float* btb,
+	const float* const midpoint[3], float* const rvalue[3], float* error )
+{
+	const int W = S::WIDTH ;
+	int i = 0 ;
+	for ( ; i + W <= n ; i += W )
+		batchSolve<S>( i, ata, atb, btb, midpoint, rvalue, error ) ;
+	if ( i == n )
+		return ;
+
+	float tata[6][W], tatb[3][W], tbtb[W], tmid[3][W], tr[3][W], terr[W] ;
+	for ( int l = 0 ; l < W ; l ++ ) {
+		int src = i + l < n ? i + l : -1 ;
+		for ( int j = 0 ; j < 6 ; j ++ )
+			tata[j][l] = src >= 0 ? ata[j][src] : 0.0f ;
+		for ( int j = 0 ; j < 3 ; j ++ ) {
+			tatb[j][l] = src >= 0 ? atb[j][src] : 0.0f ;
+			tmid[j][l] = src >= 0 ? midpoint[j][src] : 0.0f ;
+		}
+		tbtb[l] = src >= 0 ? btb[src] : 0.0f ;
+	}
+	const float* pata[6] = { tata[0], tata[1], tata[2], tata[3], tata[4], tata[5] } ;
+	const float* patb[3] = { tatb[0], tatb[1], tatb[2] } ;
+	const float* pmid[3] = { tmid[0], tmid[1], tmid[2] } ;
+	float* pr[3] = { tr[0], tr[1], tr[2] } ;
+	batchSolve<S>( 0, pata, patb, tbtb, pmid, pr, terr ) ;
+	for ( int l = 0 ; i + l < n ; l ++ ) {
+		for ( int j = 0 ; j < 3 ; j ++ )
+			rvalue[j][i + l] = tr[j][l] ;
+		error[i + l] = terr[l] ;
+	}
+}
+
+}
+
+#endif
@@ -0,0 +1,53 @@
+/*
+
+  AVX2 version of calcPointBatch(), 8 QEFs per step.
+  Compiled with -mavx2, only called when the CPU has it.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public License
+  (LGPL) as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <immintrin.h>
+#include "eigenBatch.hpp"
+
+namespace {
+
+struct LanesAVX2 {
+	enum { WIDTH = 8 } ;
+	typedef __m256 V ;
+	typedef __m256 M ;
+	static V load( const float* p ) { return _mm256_loadu_ps( p ) ; } ;
+	static void store( float* p, V v ) { _mm256_storeu_ps( p, v ) ; } ;
+	static V set( float f ) { return _mm256_set1_ps( f ) ; } ;
+	static V add( V a, V b ) { return _mm256_add_ps( a, b ) ; } ;
+	static V sub( V a, V b ) { return _mm256_sub_ps( a, b ) ; } ;
+	static V mul( V a, V b ) { return _mm256_mul_ps( a, b ) ; } ;
+	static V div( V a, V b ) { return _mm256_div_ps( a, b ) ; } ;
+	static V sqrt( V a ) { return _mm256_sqrt_ps( a ) ; } ;
+	static V abs( V a ) { return _mm256_andnot_ps( _mm256_set1_ps( -0.0f ), a ) ; } ;
+	static V neg( V a ) { return _mm256_xor_ps( _mm256_set1_ps( -0.0f ), a ) ; } ;
+	static M lt( V a, V b ) { return _mm256_cmp_ps( a, b, _CMP_LT_OQ ) ; } ;
+	static M le( V a, V b ) { return _mm256_cmp_ps( a, b, _CMP_LE_OQ ) ; } ;
+	static M eq( V a, V b ) { return _mm256_cmp_ps( a, b, _CMP_EQ_OQ ) ; } ;
+	static V select( M m, V a, V b ) { return _mm256_blendv_ps( b, a, m ) ; } ;
+	static M andMask( M a, M b ) { return _mm256_and_ps( a, b ) ; } ;
+};
+
+}
+
+void calcPointBatchAVX2 ( int n, const float* const ata[6], const float* const atb[3], const float* btb,
+	const float* const midpoint[3], float* const rvalue[3], float* error )
+{
+	batchSolveAll<LanesAVX2>( n, ata, atb, btb, midpoint, rvalue, error ) ;
+}
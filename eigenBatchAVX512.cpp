@@ -0,0 +1,53 @@
+/*
+
+  AVX-512 version of calcPointBatch(), 16 QEFs per step.
+  Compiled with -mavx512f, only called when the CPU has it.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public License
+  (LGPL) as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <immintrin.h>
+#include "eigenBatch.hpp"
+
+namespace {
+
+struct LanesAVX512 {
+	enum { WIDTH = 16 } ;
+	typedef __m512 V ;
+	typedef __mmask16 M ;
+	static V load( const float* p ) { return _mm512_loadu_ps( p ) ; } ;
+	static void store( float* p, V v ) { _mm512_storeu_ps( p, v ) ; } ;
+	static V set( float f ) { return _mm512_set1_ps( f ) ; } ;
+	static V add( V a, V b ) { return _mm512_add_ps( a, b ) ; } ;
+	static V sub( V a, V b ) { return _mm512_sub_ps( a, b ) ; } ;
+	static V mul( V a, V b ) { return _mm512_mul_ps( a, b ) ; } ;
+	static V div( V a, V b ) { return _mm512_div_ps( a, b ) ; } ;
+	static V sqrt( V a ) { return _mm512_sqrt_ps( a ) ; } ;
+	static V abs( V a ) { return _mm512_abs_ps( a ) ; } ;
+	static V neg( V a ) { return _mm512_sub_ps( _mm512_setzero_ps( ), a ) ; } ;
+	static M lt( V a, V b ) { return _mm512_cmp_ps_mask( a, b, _CMP_LT_OQ ) ; } ;
+	static M le( V a, V b ) { return _mm512_cmp_ps_mask( a, b, _CMP_LE_OQ ) ; } ;
+	static M eq( V a, V b ) { return _mm512_cmp_ps_mask( a, b, _CMP_EQ_OQ ) ; } ;
+	static V select( M m, V a, V b ) { return _mm512_mask_blend_ps( m, b, a ) ; } ;
+	static M andMask( M a, M b ) { return (M) ( a & b ) ; } ;
+};
+
+}
+
+void calcPointBatchAVX512 ( int n, const float* const ata[6], const float* const atb[3], const float* btb,
+	const float* const midpoint[3], float* const rvalue[3], float* error )
+{
+	batchSolveAll<LanesAVX512>( n, ata, atb, btb, midpoint, rvalue, error ) ;
+}
@@ -23,26 +23,150 @@
 #include "GeoCommon.hpp"
 #include "PLYReader.hpp"
 #include "PLYWriter.hpp"
+#include "BoxTree.hpp"
+#include "Parallel.hpp"
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
+#include <vector>
+#include <algorithm>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 class Intersection
 {
 public:
 	Intersection(){} ;
      // c = a x b
-	static void cross( float a[3], float b[3], float c[3] )
+	static void cross( const float a[3], const float b[3], float c[3] )
 	{
 		c[0] = a[1] * b[2] - a[2] * b[1] ;
 		c[1] = a[2] * b[0] - a[0] * b[2] ;
 		c[2] = a[0] * b[1] - a[1] * b[0] ;
 	}
 	// a dot b
-	static float dot( float a[3], float b[3] )
+	static float dot( const float a[3], const float b[3] )
 	{
 		return a[0] * b[0] + a[1] * b[1] + a[2] * b[2] ;
 	}
+
+	// The *4() tests below try four separating axes at once, one per lane.
+	// Component c of the axis of lane l is ax[c][l] and point k of a shape is
+	// p[k][c][l], so every lane can have its own pair of shapes. They return
+	// the bit mask of the lanes whose axis separates the shapes, and use the
+	// stack only: they run for every minimal edge of the intersection-free
+	// contouring.
+
+	// copy v into all four lanes
+	static void spread( const float v[3], float lanes[3][4] )
+	{
+		for ( int c = 0 ; c < 3 ; c ++ )
+		{
+			lanes[c][0] = lanes[c][1] = lanes[c][2] = lanes[c][3] = v[c] ;
+		}
+	}
+
+	// axis of lane l = a x b
+	static void cross( const float a[3], const float b[3], float ax[3][4], int l )
+	{
+		ax[0][l] = a[1] * b[2] - a[2] * b[1] ;
+		ax[1][l] = a[2] * b[0] - a[0] * b[2] ;
+		ax[2][l] = a[0] * b[1] - a[1] * b[0] ;
+	}
+
+#ifdef __SSE2__
+	// smallest and largest projection of the n points p on the axes x, y, z,
+	// the products are summed in the order of dot()
+	static void project4( __m128 x, __m128 y, __m128 z, const float p[][3][4], int n, __m128& mn, __m128& mx )
+	{
+		for ( int k = 0 ; k < n ; k ++ )
+		{
+			__m128 d = _mm_add_ps( _mm_add_ps( _mm_mul_ps( x, _mm_loadu_ps( p[k][0] ) ),
+				_mm_mul_ps( y, _mm_loadu_ps( p[k][1] ) ) ), _mm_mul_ps( z, _mm_loadu_ps( p[k][2] ) ) ) ;
+			mn = k == 0 ? d : _mm_min_ps( mn, d ) ;
+			mx = k == 0 ? d : _mm_max_ps( mx, d ) ;
+		}
+	}
+#else
+	static void project4( const float ax[3][4], const float p[][3][4], int n, float mn[4], float mx[4] )
+	{
+		for ( int l = 0 ; l < 4 ; l ++ )
+		{
+			for ( int k = 0 ; k < n ; k ++ )
+			{
+				float d = ax[0][l] * p[k][0][l] + ax[1][l] * p[k][1][l] + ax[2][l] * p[k][2][l] ;
+				mn[l] = k == 0 || d < mn[l] ? d : mn[l] ;
+				mx[l] = k == 0 || d > mx[l] ? d : mx[l] ;
+			}
+		}
+	}
+#endif
+
+	/// Lanes where the n1 points p1 and the n2 points p2 do not overlap, as separating( axes, t1, t2 )
+	static int separating4( const float ax[3][4], const float p1[][3][4], int n1, const float p2[][3][4], int n2 )
+	{
+#ifdef __SSE2__
+		__m128 x = _mm_loadu_ps( ax[0] ), y = _mm_loadu_ps( ax[1] ), z = _mm_loadu_ps( ax[2] ) ;
+		__m128 min1, max1, min2, max2 ;
+		project4( x, y, z, p1, n1, min1, max1 ) ;
+		project4( x, y, z, p2, n2, min2, max2 ) ;
+		return _mm_movemask_ps( _mm_or_ps( _mm_cmpge_ps( min1, max2 ), _mm_cmpge_ps( min2, max1 ) ) ) ;
+#else
+		float min1[4], max1[4], min2[4], max2[4] ;
+		project4( ax, p1, n1, min1, max1 ) ;
+		project4( ax, p2, n2, min2, max2 ) ;
+		int mask = 0 ;
+		for ( int l = 0 ; l < 4 ; l ++ )
+		{
+			if ( min1[l] >= max2[l] || min2[l] >= max1[l] )
+			{
+				mask |= 1 << l ;
+			}
+		}
+		return mask ;
+#endif
+	}
+
+	/// Same with unit axes and a small tolerance, as separating( axes, t1, v1, v2 )
+	static int separatingTol4( const float ax[3][4], const float p1[][3][4], int n1, const float p2[][3][4], int n2 )
+	{
+#ifdef __SSE2__
+		__m128 x = _mm_loadu_ps( ax[0] ), y = _mm_loadu_ps( ax[1] ), z = _mm_loadu_ps( ax[2] ) ;
+		__m128 mag = _mm_sqrt_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( x, x ), _mm_mul_ps( y, y ) ), _mm_mul_ps( z, z ) ) ) ;
+		x = _mm_div_ps( x, mag ) ;
+		y = _mm_div_ps( y, mag ) ;
+		z = _mm_div_ps( z, mag ) ;
+		__m128 min1, max1, min2, max2 ;
+		project4( x, y, z, p1, n1, min1, max1 ) ;
+		project4( x, y, z, p2, n2, min2, max2 ) ;
+		__m128 tol = _mm_set1_ps( 0.00001f ) ;
+		return _mm_movemask_ps( _mm_or_ps( _mm_cmpgt_ps( min1, _mm_add_ps( max2, tol ) ),
+			_mm_cmpgt_ps( min2, _mm_add_ps( max1, tol ) ) ) ) ;
+#else
+		float unit[3][4] ;
+		for ( int l = 0 ; l < 4 ; l ++ )
+		{
+			float mag = sqrt( ax[0][l] * ax[0][l] + ax[1][l] * ax[1][l] + ax[2][l] * ax[2][l] ) ;
+			for ( int c = 0 ; c < 3 ; c ++ )
+			{
+				unit[c][l] = ax[c][l] / mag ;
+			}
+		}
+		float min1[4], max1[4], min2[4], max2[4] ;
+		project4( unit, p1, n1, min1, max1 ) ;
+		project4( unit, p2, n2, min2, max2 ) ;
+		int mask = 0 ;
+		for ( int l = 0 ; l < 4 ; l ++ )
+		{
+			if ( min1[l] > max2[l] + 0.00001f || min2[l] > max1[l] + 0.00001f )
+			{
+				mask |= 1 << l ;
+			}
+		}
+		return mask ;
+#endif
+	}
 	
 	
 	static int separating( float axes[3], Triangle* t1, Triangle* t2 )
@@ -195,68 +319,96 @@ public:
 	}
 	
 	static int testIntersection( Triangle* t1, Triangle* t2 )
+	{
+		return testIntersection( t1->vt, t2->vt ) ;
+	}
+
+	/// Triangle-triangle test on the stack, the eleven axes go four at a time
+	static int testIntersection( const float t1[3][3], const float t2[3][3] )
 	{
 		// Two face normals
-		float v1[3][3] = {{ t1->vt[1][0] - t1->vt[0][0], t1->vt[1][1] - t1->vt[0][1], t1->vt[1][2] - t1->vt[0][2] },
-		{ t1->vt[2][0] - t1->vt[1][0], t1->vt[2][1] - t1->vt[1][1], t1->vt[2][2] - t1->vt[1][2] },
-		{ t1->vt[0][0] - t1->vt[2][0], t1->vt[0][1] - t1->vt[2][1], t1->vt[0][2] - t1->vt[2][2] }};
-		float v2[3][3] = {{ t2->vt[1][0] - t2->vt[0][0], t2->vt[1][1] - t2->vt[0][1], t2->vt[1][2] - t2->vt[0][2] },
-		{ t2->vt[2][0] - t2->vt[1][0], t2->vt[2][1] - t2->vt[1][1], t2->vt[2][2] - t2->vt[1][2] },
-		{ t2->vt[0][0] - t2->vt[2][0], t2->vt[0][1] - t2->vt[2][1], t2->vt[0][2] - t2->vt[2][2] } };
-		float n1[3], n2[3] ; 
+		float v1[3][3], v2[3][3] ;
+		int i, j ;
+		for ( i = 0 ; i < 3 ; i ++ )
+		{
+			for ( j = 0 ; j < 3 ; j ++ )
+			{
+				v1[i][j] = t1[(i+1)%3][j] - t1[i][j] ;
+				v2[i][j] = t2[(i+1)%3][j] - t2[i][j] ;
+			}
+		}
+		float n1[3], n2[3] ;
 		cross( v1[0], v1[1], n1 ) ;
 		cross( v2[0], v2[1], n2 ) ;
-		
+
+		float p1[3][3][4], p2[3][3][4] ;
+		for ( i = 0 ; i < 3 ; i ++ )
+		{
+			spread( t1[i], p1[i] ) ;
+			spread( t2[i], p2[i] ) ;
+		}
+
 		float n[3] ;
 		cross( n1, n2, n ) ;
-		int i, j ;
+		float ax[3][4] ;
 		if ( n[0] == 0 && n[1] == 0 && n[2] == 0 )
 		{
 			// Co-planar
-			
-			if ( dot( n1, t1->vt[0] ) != dot( n1, t2->vt[0] ) )
+			if ( dot( n1, t1[0] ) != dot( n1, t2[0] ) )
 			{
 				return 0 ;
 			}
-			
-			float axes[3] ;
-			for ( i = 0 ; i < 3 ; i ++ )
+
+			// edge normals in the plane, the last lane repeats the third
+			for ( i = 0 ; i < 4 ; i ++ )
 			{
-				cross( n1, v1[i], axes ) ;
-				if ( separating( axes, t1, t2 ) )
-				{
-					return 0 ;
-				}
+				cross( n1, v1[i < 3 ? i : 2], ax, i ) ;
 			}
-			for ( i = 0 ; i < 3 ; i ++ )
+			if ( separating4( ax, p1, 3, p2, 3 ) )
 			{
-				cross( n2, v2[i], axes ) ;
-				if ( separating( axes, t1, t2 ) )
-				{
-					return 0 ;
-				}
+				return 0 ;
+			}
+			for ( i = 0 ; i < 4 ; i ++ )
+			{
+				cross( n2, v2[i < 3 ? i : 2], ax, i ) ;
+			}
+			if ( separating4( ax, p1, 3, p2, 3 ) )
+			{
+				return 0 ;
 			}
 		}
 		else
 		{
-			// Non co-planar
-			if ( separating( n1, t1, t2 ) || separating( n2, t1, t2 ) )
+			// Non co-planar: the normals and the nine edge cross products,
+			// the last lane repeats the first normal
+			float axes[12][3] ;
+			for ( j = 0 ; j < 3 ; j ++ )
 			{
-				return 0 ;
+				axes[0][j] = axes[11][j] = n1[j] ;
+				axes[1][j] = n2[j] ;
 			}
-			
-			float axes[3] ;
 			for ( i = 0 ; i < 3 ; i ++ )
+			{
 				for ( j = 0 ; j < 3 ; j ++ )
 				{
-					cross( v1[i], v2[j], axes ) ;
-					if ( separating( axes, t1, t2 ) )
-					{
-						return 0 ;
-					}
+					cross( v1[i], v2[j], axes[2 + 3 * i + j] ) ;
 				}
+			}
+			for ( i = 0 ; i < 12 ; i += 4 )
+			{
+				for ( j = 0 ; j < 4 ; j ++ )
+				{
+					ax[0][j] = axes[i + j][0] ;
+					ax[1][j] = axes[i + j][1] ;
+					ax[2][j] = axes[i + j][2] ;
+				}
+				if ( separating4( ax, p1, 3, p2, 3 ) )
+				{
+					return 0 ;
+				}
+			}
 		}
-		
+
 		return 1 ;
 	}
 
@@ -338,30 +490,10 @@ public:
 		return 1 ;
 	}
 	
-	static int testIntersection( char* fname, char* outname )
+	/// Integer bounding boxes of num triangles, as the pair tests use them
+	static void triangleBoxes( Triangle** tris, int num, BoundingBox* boxes )
 	{
-		Triangle *intertris[100000];
-		
-		// Read triangles
-		PLYReader* myreader = new PLYReader( fname, 1 ) ;
-		int numpoly = myreader->getNumTriangles() ;
-		int num = 0 ;
-		Triangle** tris = new Triangle *[ numpoly ] ;
-		Triangle* tri = NULL ;
-		myreader->reset() ;
-		while( (tri = myreader->getNextTriangle()) != NULL )
-		{
-			tris[ num ] = tri ;
-			num ++ ;
-		}
-		myreader->close() ;
-		printf("Reading %d polygons, %d triangles.\n", numpoly, num ) ;
-		
-		// Build bounding boxes
-		printf("Building bounding boxes...\n") ;
-		int i ;
-		BoundingBox* boxes = new BoundingBox[ num ] ;
-		for ( i = 0 ; i < num ; i ++ )
+		for ( int i = 0 ; i < num ; i ++ )
 		{
 			Triangle* t = tris[ i ] ;
 			
@@ -403,39 +535,83 @@ public:
 			}
 			
 		}
-		
-		// Test intersections
-		printf("Pairwise searching...\n") ;
-		int numinters = 0 ;
-		for ( i = 0 ; i < num ; i ++ )
-		{
-			for ( int j = 0 ; j < i ; j ++ )
+	}
+
+	/// Exact tests of the pairs i, j on nthreads threads, 0 means one per core.
+	/// candidates( i, list ) adds to list the triangles that may intersect
+	/// triangle i, duplicates and j >= i are dropped here. The indices i, j
+	/// (j < i) of the intersecting pairs go to intertris in the order of a loop
+	/// over i and then j, with any number of threads. numPairs gets the number
+	/// of pairs given to the exact test.
+	template <class C>
+	static int testCandidates( Triangle** tris, const BoundingBox* boxes, int num, C candidates,
+		std::vector<int>& intertris, int nthreads = 0, long long* numPairs = NULL )
+	{
+		// each block of triangles is one work item with its own list of pairs
+		const int BLOCK = 1024 ;
+		int nblocks = ( num + BLOCK - 1 ) / BLOCK ;
+		nthreads = Parallel::numThreads( nthreads ) ;
+		std::vector< std::vector<int> > found( nblocks ) ;
+		std::vector<long long> tested( nblocks, 0 ) ;
+		std::vector< std::vector<int> > cands( nthreads ) ; // scratch of each worker
+		Parallel::parallelFor( nblocks, nthreads, [&]( int b, int worker ) {
+			std::vector<int>& cand = cands[ worker ] ;
+			int end = ( b + 1 ) * BLOCK < num ? ( b + 1 ) * BLOCK : num ;
+			for ( int i = b * BLOCK ; i < end ; i ++ )
 			{
-				if ( testIntersection( tris[i], boxes[i], tris[j], boxes[j], 0 ) )
+				cand.clear() ;
+				candidates( i, cand ) ;
+				std::sort( cand.begin(), cand.end() ) ;
+				for ( size_t k = 0 ; k < cand.size() && cand[k] < i ; k ++ )
 				{
-					intertris[ 2 * numinters ] = tris[i] ;
-					intertris[ 2 * numinters + 1 ] = tris[j] ;
-					numinters ++ ;
-				
-					/*
-					printf("First tri: ");
-					for ( int k = 0 ; k < 3 ; k ++ )
+					int j = cand[k] ;
+					if ( k > 0 && j == cand[k - 1] )
 					{
-						printf("(%f %f %f),", tris[i]->vt[k][0], tris[i]->vt[k][1],tris[i]->vt[k][2]);
+						continue ;
 					}
-					printf("\nSecond tri: ");
-					for ( k = 0 ; k < 3 ; k ++ )
+					tested[b] ++ ;
+					if ( testIntersection( tris[i], boxes[i], tris[j], boxes[j], 0 ) )
 					{
-						printf("(%f %f %f),", tris[j]->vt[k][0], tris[j]->vt[k][1],tris[j]->vt[k][2]);
+						found[b].push_back( i ) ;
+						found[b].push_back( j ) ;
 					}
-					// printf("\n") ;
-					*/
 				}
 			}
+		} ) ;
+
+		// Blocks in order, so the result does not depend on the threads
+		intertris.clear() ;
+		long long numcand = 0 ;
+		for ( int b = 0 ; b < nblocks ; b ++ )
+		{
+			intertris.insert( intertris.end(), found[b].begin(), found[b].end() ) ;
+			numcand += tested[b] ;
 		}
-		
-		// Write out
-		printf("Write out...\n") ;
+		if ( numPairs != NULL )
+		{
+			*numPairs = numcand ;
+		}
+		return (int) intertris.size() / 2 ;
+	}
+
+	/// Self-intersection test of num triangles, see testCandidates(). Only the
+	/// pairs whose boxes overlap are tested, they are found with a BoxTree.
+	static int findIntersections( Triangle** tris, int num, std::vector<int>& intertris, int nthreads = 0, long long* numPairs = NULL )
+	{
+		BoundingBox* boxes = new BoundingBox[ num ] ;
+		triangleBoxes( tris, num, boxes ) ;
+		BoxTree tree( boxes, num ) ;
+		int numinters = testCandidates( tris, boxes, num, [&]( int i, std::vector<int>& cand ) {
+			tree.query( boxes[i], [&]( int j ) { if ( j < i ) cand.push_back( j ) ; } ) ;
+		}, intertris, nthreads, numPairs ) ;
+		delete[] boxes ;
+		return numinters ;
+	}
+
+	/// Write the pairs of intersecting triangles found by testCandidates() to outname
+	static void writeIntersections( char* outname, Triangle** tris, const std::vector<int>& intertris )
+	{
+		int numinters = (int) intertris.size() / 2 ;
 		if ( numinters > 0  )
 		{
 			FILE* intout = fopen( outname, "wb" ) ;
@@ -445,12 +621,12 @@ public:
 			// Write vertices
 			for ( int i = 0 ; i < numinters ; i ++ )
 			{
-				t = intertris[ 2 * i ] ;
+				t = tris[ intertris[ 2 * i ] ] ;
 				for ( int j = 0 ; j < 3 ; j ++ )
 				{
 					PLYWriter::writeVertex( intout, t->vt[j] ) ;
 				}
-				t = intertris[ 2 * i + 1 ] ;
+				t = tris[ intertris[ 2 * i + 1 ] ] ;
 				for ( int j = 0 ; j < 3 ; j ++ )
 				{
 					PLYWriter::writeVertex( intout, t->vt[j] ) ;
@@ -468,6 +644,45 @@ public:
 			
 			fclose( intout ) ;
 		}
+	}
+
+	static int testIntersection( char* fname, char* outname, int nthreads = 0 )
+	{
+		// Read triangles
+		PLYReader* myreader = new PLYReader( fname, 1 ) ;
+		int numpoly = myreader->getNumTriangles() ;
+		int num = 0 ;
+		Triangle** tris = new Triangle *[ numpoly ] ;
+		Triangle* tri = NULL ;
+		myreader->reset() ;
+		while( (tri = myreader->getNextTriangle()) != NULL )
+		{
+			tris[ num ] = tri ;
+			num ++ ;
+		}
+		myreader->close() ;
+		printf("Reading %d polygons, %d triangles.\n", numpoly, num ) ;
+		
+		// Test intersections
+		printf("Searching on %d threads...\n", Parallel::numThreads( nthreads ) ) ;
+		double t0 = Parallel::wallTime() ;
+		std::vector<int> intertris ; // i, j of each intersecting pair
+		long long numcand = 0 ;
+		int numinters = findIntersections( tris, num, intertris, nthreads, &numcand ) ;
+		double t1 = Parallel::wallTime() ;
+		printf("%lld candidate pairs tested in %f seconds, %.0f pairs per second.\n",
+			numcand, t1 - t0, t1 > t0 ? numcand / ( t1 - t0 ) : 0.0 ) ;
+		
+		// Write out
+		printf("Write out...\n") ;
+		writeIntersections( outname, tris, intertris ) ;
+
+		for ( int i = 0 ; i < num ; i ++ )
+		{
+			delete tris[i] ;
+		}
+		delete[] tris ;
+		delete myreader ;
 		
 		return numinters ;
 	}
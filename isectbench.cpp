@@ -0,0 +1,95 @@
+/*
+
+  Benchmark of the self-intersection test in intersection.hpp.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public License
+  (LGPL) as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "intersection.hpp"
+#include "Parallel.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+/*	Parameters
+ *	argv[1]:	(OPTIONAL) number of triangles (default 200000)
+ *	argv[2]:	(OPTIONAL) number of threads for the parallel run (default one per core)
+ *
+ *	The triangles are long and thin, up to 3 units across, scattered in a box
+ *	with about one triangle per unit cell, so most candidate pairs reach the
+ *	exact test like on dense CAD parts. findIntersections() runs once on one
+ *	thread and once on all threads; both must find the same pairs.
+*/
+
+static float frand( ) {
+	return (float) rand( ) / (float) RAND_MAX ;
+}
+
+static void makeTriangles( int n, std::vector<Triangle>& tris ) {
+	srand( 1 ) ;
+	int side = 1 ;
+	while ( side * side * side < n )
+		side ++ ;
+	tris.resize( n ) ;
+	for ( int i = 0 ; i < n ; i ++ ) {
+		float st[3] ;
+		for ( int j = 0 ; j < 3 ; j ++ )
+			st[j] = frand( ) * side ;
+		// a sliver: two corners far apart along a random direction, one close to them
+		for ( int j = 0 ; j < 3 ; j ++ ) {
+			float dir = frand( ) * 3 - 1.5f ;
+			tris[i].vt[0][j] = st[j] ;
+			tris[i].vt[1][j] = st[j] + dir ;
+			tris[i].vt[2][j] = st[j] + dir * 0.5f + ( frand( ) - 0.5f ) * 0.2f ;
+		}
+	}
+}
+
+int main( int args, char* argv[] )
+{
+	int n = args > 1 ? atoi( argv[1] ) : 200000 ;
+	int nthreads = Parallel::numThreads( args > 2 ? atoi( argv[2] ) : 0 ) ;
+	if ( n <= 0 ) {
+		printf("Usage: %s [number of triangles] [threads]\n", argv[0] ) ;
+		return 1 ;
+	}
+
+	std::vector<Triangle> tris ;
+	makeTriangles( n, tris ) ;
+	std::vector<Triangle*> ptrs( n ) ;
+	for ( int i = 0 ; i < n ; i ++ )
+		ptrs[i] = &tris[i] ;
+
+	printf("%d triangles, parallel run on %d threads\n", n, nthreads ) ;
+	printf("%-10s %14s %12s %14s %12s\n", "threads", "pairs", "ns/pair", "pairs/s", "found" ) ;
+	std::vector<int> single, parallel ;
+	const int runs[2] = { 1, nthreads } ;
+	for ( int r = 0 ; r < 2 ; r ++ ) {
+		std::vector<int>& found = r == 0 ? single : parallel ;
+		long long pairs = 0 ;
+		double t0 = Parallel::wallTime( ) ;
+		int num = Intersection::findIntersections( &ptrs[0], n, found, runs[r], &pairs ) ;
+		double t1 = Parallel::wallTime( ) ;
+		printf("%-10d %14lld %12.1f %14.0f %12d\n", runs[r], pairs,
+			pairs > 0 ? 1e9 * ( t1 - t0 ) / pairs : 0.0, t1 > t0 ? pairs / ( t1 - t0 ) : 0.0, num ) ;
+	}
+	if ( single != parallel ) {
+		printf("Wrong! %d threads find different pairs than one\n", nthreads ) ;
+		return 1 ;
+	}
+
+	return 0 ;
+}
@@ -1,1935 +1,3134 @@
-/*
-
-  Implementations of Octree member functions.
-
-  Copyright (C) 2011  Tao Ju
-
-  This library is free software; you can redistribute it and/or
-  modify it under the terms of the GNU Lesser General Public License
-  (LGPL) as published by the Free Software Foundation; either
-  version 2.1 of the License, or (at your option) any later version.
-
-  This library is distributed in the hope that it will be useful,
-  but WITHOUT ANY WARRANTY; without even the implied warranty of
-  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
-  Lesser General Public License for more details.
-
-  You should have received a copy of the GNU Lesser General Public
-  License along with this library; if not, write to the Free Software
-  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
-*/
-
-
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include <time.h>
-
-#include <iostream>
-#include <cassert>
-
-#include "octree.hpp"
-#include "PLYWriter.hpp"
-
-
-#if _WIN64 || __x86_64__ || __ppc64__
-	#define ENVIRONMENT64
-#else
-	#define ENVIRONMENT32
-#endif
-
-
-#ifdef ENVIRONMENT64
-	typedef long int ptr_type;
-#else
-	typedef int ptr_type;
-#endif
-
-Octree::Octree( char* fname,  double threshold )
-{
-	simplify_threshold = threshold;
-	// Recognize file format
-	/*
-	if ( strstr( fname, ".sog" ) != NULL || strstr( fname, ".SOG" ) != NULL ) {
-		printf("Reading SOG file format.\n") ;
-		this->hasQEF = 0 ;
-		readSOG( fname ) ;
-	}*/
-	if ( strstr( fname, ".dcf" ) != NULL || strstr( fname, ".DCF" ) != NULL ) {
-		printf("Reading DCF file format.\n") ;
-		this->hasQEF = 1 ;
-		readDCF( fname ) ;
-	}
-	else {
-		printf("Wrong input format. Must be SOG/DCF.\n");
-		exit(0) ;
-	}
-
-}
-
-void Octree::simplify( float thresh ) {
-	if ( this->hasQEF ) {
-		int st[3] = {0,0,0} ;
-		this->root = simplify( this->root, st, this->dimen, thresh ) ;
-	}
-}
-
-// simplify by collapsing nodes where the parent node QEF solution is good enough
-OctreeNode* Octree::simplify( OctreeNode* node, int st[3], int len, float thresh ) {
-	if ( node == NULL )
-		return NULL ;
-
-	//NodeType type =  ;
-
-	if ( node->getType() == INTERNAL ) {
-		InternalNode* inode = (InternalNode*)node ;
-		int simple = 1;
-
-		// QEF data
-		float ata[6] = { 0, 0, 0, 0, 0, 0 };
-		float atb[3] = { 0, 0, 0 } ;
-		float pt[3] = { 0, 0, 0 } ;
-		//float mp[3] = { 0, 0, 0 } ;
-		float btb = 0 ;
-		int signs[8] = {-1,-1,-1,-1,-1,-1,-1,-1} ;
-		int midsign = -1 ;
-
-		// child data
-		int nlen = len / 2 ;
-		int nst[3] ;
-		int ec = 0 ;
-		int ht ;
-
-		for ( int i = 0 ; i < 8 ; i ++ ) { // recurse into tree
-			nst[0] = st[0] + vertMap[i][0] * nlen ;
-			nst[1] = st[1] + vertMap[i][1] * nlen ;
-			nst[2] = st[2] + vertMap[i][2] * nlen ;
-
-			inode->child[i] = simplify( inode->child[i], nst, nlen, thresh ) ;
-			
-			if ( inode->child[i] != NULL ) {
-				if ( inode->child[i]->getType() == INTERNAL ) {
-					simple = 0 ;
-				}
-				else if ( inode->child[i]->getType() == LEAF ) { // sum child leaf QEFs
-					LeafNode* lnode = (LeafNode *) inode->child[i] ;
-					ht = lnode->height ;
-
-					for ( int j = 0 ; j < 6 ; j ++ )
-						ata[j] += lnode->ata[j] ; 
-
-					for ( int j = 0 ; j < 3 ; j ++ ) {
-						atb[j] += lnode->atb[j] ;
-						pt[j] += lnode->mp[j] ;
-					}
-					if ( lnode->mp[0] == 0 )
-						printf("%f %f %f, Height: %d\n", lnode->mp[0], lnode->mp[1], lnode->mp[2], ht) ;
-
-					btb += lnode->btb ;
-					ec++ ; // QEF count (?)
-
-					midsign = lnode->getSign( 7 - i ) ;
-					signs[i] = lnode->getSign( i ) ;
-				}
-				else { // pseudoleaf
-					assert( inode->child[i]->getType() == PSEUDOLEAF );
-					PseudoLeafNode* pnode = (PseudoLeafNode *) inode->child[i];
-					ht = pnode->height ;
-
-					for ( int j = 0 ; j < 6 ; j ++ )
-						ata[j] += pnode->ata[j] ;
-
-					for ( int j = 0 ; j < 3 ; j ++ ) {
-						atb[j] += pnode->atb[j] ;
-						pt[j] += pnode->mp[j] ;
-					}
-					btb += pnode->btb ;
-					ec ++ ;
-
-					midsign = pnode->getSign( 7 - i ) ;
-					signs[i] = pnode->getSign( i ) ;
-				}
-			}
-		} // all QEFs summed 
-
-		if ( simple ) { // one or more child INTERNAL (?)
-			if ( ec == 0 ) { // no QEFs found/summed above ( all childs INTERNAL ?)
-				//printf("deleting INTERNAL node because all children INTERNAL\n");
-				delete node;
-				return NULL;
-			}
-			else {
-				pt[0] = pt[0] / ec; // average of summed points
-				pt[1] = pt[1] / ec;
-				pt[2] = pt[2] / ec;
-				//if ( pt[0] < st[0] || pt[1] < st[1] || pt[2] < st[2] ||
-				//	pt[0] > st[0] + len || pt[1] > st[1] + len || pt[2] > st[2] + len )
-				//{ // pt outside node cube
-					//printf("Out! %f %f %f, Box: (%d %d %d) Len: %d ec: %d\n", pt[0], pt[1], pt[2], st[0],st[1],st[2],len,ec) ;
-				//}
-
-				unsigned char sg = 0 ;
-				for ( int i = 0 ; i < 8 ; i ++ ) {
-					if ( signs[i] == 1 )
-						sg |= ( 1 << i ) ;
-					else if ( signs[i] == -1 ) {  // Undetermined, use center sign instead
-						if ( midsign == 1 )
-							sg |= ( 1 << i ) ;
-						else if ( midsign == -1 )
-							printf("Wrong!");
-					}
-				}
-
-				// Solve QEF for parent node
-				float mat[10];
-				BoundingBoxf* box = new BoundingBoxf();
-				box->begin.x = (float) st[0] ;
-				box->begin.y = (float) st[1] ;
-				box->begin.z = (float) st[2] ;
-				box->end.x = (float) st[0] + len ;
-				box->end.y = (float) st[1] + len ;
-				box->end.z = (float) st[2] + len ;
-				// pt is the average of child-nodes
-				// mp is the new solution point
-				float mp[3] = { 0, 0, 0 } ;
-				float error = calcPoint( ata, atb, btb, pt, mp, box, mat ) ;
-#ifdef CLAMP
-				if ( mp[0] < st[0] || mp[1] < st[1] || mp[2] < st[2] || // mp is outside boudning-box
-					mp[0] > st[0] + len || mp[1] > st[1] + len || mp[2] > st[2] + len ) {
-					mp[0] = pt[0] ;
-					mp[1] = pt[1] ;
-					mp[2] = pt[2] ;
-				}
-#endif
-				if ( error <= thresh ) { // if parent QEF solution is good enough
-					PseudoLeafNode* pnode = new PseudoLeafNode( ht+1, sg, ata, atb, btb, mp ) ;
-					delete inode ;
-					return pnode ;
-				}
-				else { // QEF solution not good enough
-					return node ;
-				}
-			}
-			
-		} else { // simple == 0
-			return node ;
-		}
-	} else { // type != INTERNAL
-		return node ;
-	}
-}
-
-
-
-void Octree::readDCF( char* fname ) {
-	FILE* fin = fopen( fname, "rb" ) ;
-	if ( fin == NULL )
-		printf("Can not open file %s.\n", fname) ;
-	
-	// Process header
-	char version[10] ;
-	fread( version, sizeof( char ), 10, fin ) ;
-	if ( strcmp( version, "multisign" ) != 0 ) {
-		printf("Wrong DCF version.\n") ;
-		exit(0) ;
-	}
-	
-	fread( &(this->dimen), sizeof( int ), 1, fin ) ;
-	fread( &(this->dimen), sizeof( int ), 1, fin ) ;
-	fread( &(this->dimen), sizeof( int ), 1, fin ) ;
-	this->maxDepth = 0 ;
-	int temp = 1 ;
-	while ( temp < this->dimen ) {
-		maxDepth ++ ;
-		temp <<= 1 ;
-	}
-	printf(" dimen: %d maxDepth: %d\n", this->dimen, maxDepth ) ;
-
-	// Recursive reader
-	int st[3] = {0, 0, 0} ;
-	this->root = readDCF( fin, st, dimen, maxDepth ) ;
-	int nodecount[3];
-	countNodes( nodecount );
-	std::cout << " Read nodes from file: Internal " << nodecount[0] << "\tPseudo " << nodecount[1] << "\tLeaf " << nodecount[2] << "\n";
-
-	// optional octree simplification
-	if (simplify_threshold > 0 ) {
-		std::cout << "Simplifying with threshold " << simplify_threshold << "\n";
-		int nodecount1[3],nodecount2[3];
-		countNodes( nodecount1 );
-		std::cout << " Before simplify: Internal " << nodecount1[0] << "\tPseudo " << nodecount1[1] << "\tLeaf " << nodecount1[2] << "\n";
-		simplify( simplify_threshold );
-		countNodes( nodecount2 );
-		std::cout << "  After simplify: Internal " << nodecount2[0] << "\tPseudo " << nodecount2[1] << "\tLeaf " << nodecount2[2] << "\n";
-		std::cout << "  Nodecount I+P+L reduced from " << nodecount1[0]+nodecount1[1]+nodecount1[2] << " to " << nodecount2[0]+nodecount2[1]+nodecount2[2] << "\n";
-	}
-	printf("Done reading.\n") ;	
-	fclose( fin ) ;
-}
-
-// only InternalNode and LeafNode returned by this function
-// st cube corner (x,y,z)
-// len cube side length
-// ht node depth (root has 0, leaf has maxDepth)
-//
-// recursive reader
-OctreeNode* Octree::readDCF( FILE* fin, int st[3], int len, int height ) {
-	OctreeNode* rvalue = NULL ;
-
-	int type ;
-	fread( &type, sizeof( int ), 1, fin ) ;  // Get type
-	//printf("%d %d (%02d, %02d, %02d) NodeType: %d\n", height, len, st[0], st[1], st[2], type);
-
-	if ( type == 0 ) { // Internal node
-		rvalue = new InternalNode() ;
-		int child_len = len / 2 ; // len of child node is half that of parent
-		int child_st[3] ;
-
-		for ( int i = 0 ; i < 8 ; i ++ ) {  // create eight child nodes
-			child_st[0] = st[0] + vertMap[i][0] * child_len; // child st position
-			child_st[1] = st[1] + vertMap[i][1] * child_len;
-			child_st[2] = st[2] + vertMap[i][2] * child_len;
-			((InternalNode *)rvalue)->child[i] = readDCF( fin, child_st, child_len, height - 1 ) ; // height is one less than parent
-		}
-		return rvalue ;
-	}
-	
-	else if ( type == 1 ) { // Empty node, 
-		short sg ;
-		fread( &sg, sizeof( short ), 1, fin ) ; // signs not used??
-		assert( rvalue == NULL );
-		return rvalue ;
-	}
-	
-	else if ( type == 2 ) { // Leaf node
-		short rsg[8] ;
-		fread( rsg, sizeof( short ), 8, fin ) ;
-		unsigned char sg = 0 ;
-		for ( int i = 0 ; i < 8 ; i ++ ) { // set signs
-			if ( rsg[i] != 0 )
-				sg |= ( 1 << i ) ;
-		}
-
-		// intersections and normals
-		float inters[12][3], norms[12][3] ;
-		int numinters = 0;
-		for ( int i = 0 ; i < 12 ; i ++ ) { // potentially there are 12 intersections, one for each edge of the cube
-			int num = 0;
-			fread( &num, sizeof( int ), 1, fin ) ;
-			//if ( num > 0 ) {
-				for ( int j = 0 ; j < num ; j ++ ) {
-					float off ;
-					fread( &off, sizeof( float ), 1, fin ) ;
-					fread( norms[numinters], sizeof( float ), 3, fin ) ; // normals
-					
-					int dir = i / 4 ;
-					int base = edgevmap[ i ][ 0 ] ;
-					inters[numinters][0] = st[0] + vertMap[base][0] * len ;
-					inters[numinters][1] = st[1] + vertMap[base][1] * len ;
-					inters[numinters][2] = st[2] + vertMap[base][2] * len ;
-					inters[numinters][dir] += off ;
-					numinters ++ ;
-				}
-			//}
-		}
-		
-		if ( numinters > 0 )
-			rvalue = new LeafNode( height, sg, st, len, numinters, inters, norms ) ;
-		else
-			rvalue = NULL ;
-		
-		return rvalue ;
-	}
-	else {
-		printf("Wrong! Node Type: %d\n", type);
-		exit(-1);
-	}
-}
-
-// no-intersections algorithm
-// fname is the PLY output file
-void Octree::genContourNoInter2( char* fname ) {
-	int numTris = 0 ;
-	int numVertices = 0 ;
-	IndexedTriangleList* tlist = new IndexedTriangleList();
-	VertexList* vlist = new VertexList();
-	tlist->next = NULL ;
-	vlist->next = NULL ;
-
-	founds = 0 ;
-	news = 0 ;
-
-	// generate triangles
-	faceVerts = 0 ;
-	edgeVerts = 0 ;
-	HashMap* hash = new HashMap();
-	int st[3] = {0,0,0};
-	printf("Processing contour...\n") ;
-
-	clock_t start = clock( ) ;
-	// one cellProc call to root processes entire tree
-	cellProcContourNoInter2( root, st, dimen, hash, tlist, numTris, vlist, numVertices ) ;
-	clock_t finish = clock( ) ;
-	printf("Time used: %f seconds.\n", (float) (finish - start) / (float) CLOCKS_PER_SEC ) ;
-	
-	printf("Face vertices: %d Edge vertices: %d\n", faceVerts, edgeVerts ) ;
-	printf("New hash entries: %d. Found times: %d\n", news, founds) ;
-
-	// Finally, turn into PLY
-	FILE* fout = fopen ( fname, "wb" ) ;
-	printf("Vertices counted: %d Triangles counted: %d \n", numVertices, numTris ) ;
-	PLYWriter::writeHeader( fout, numVertices, numTris ) ;
-
-	VertexList* v = vlist->next ;
-	while ( v != NULL ) {
-		PLYWriter::writeVertex( fout, v->vt ) ;
-		v = v->next ;
-	}
-
-	IndexedTriangleList* t = tlist->next ;
-	for ( int i = 0 ; i < numTris ; i ++ ) {
-		int inds[] = {numVertices - 1 - t->vt[0], numVertices - 1 - t->vt[1], numVertices - 1 - t->vt[2]} ;
-		PLYWriter::writeFace( fout, 3, inds ) ;
-		t = t->next ;
-	}
-
-	fclose( fout ) ;
-
-	// Clear up
-	delete hash ;
-	v = vlist ;
-	while ( v != NULL ) {
-		vlist = v->next ;
-		delete v ;
-		v = vlist ;
-	}
-	t = tlist ;
-	while ( t != NULL ) {
-		tlist = t->next ;
-		delete t ;
-		t = tlist ;
-	}
-}
-
-
-// original algorithm
-// may produce intersecting polygons?
-void Octree::genContour( char* fname ) {
-	int numTris = 0 ;
-	int numVertices = 0 ;
-
-	FILE* fout = fopen ( fname, "wb" ) ;
-	cellProcCount ( root, numVertices, numTris ) ;
-	printf("numVertices: %d numTriangles: %d \n", numVertices, numTris ) ;
-	PLYWriter::writeHeader( fout, numVertices, numTris ) ;
-	int offset = 0; // start of vertex index
-
-	clock_t start = clock();
-	generateVertexIndex( root, offset, fout );  // write vertices to file, populate node->index
-	printf("Wrote %d vertices to file\n", offset ) ;
-
-	actualTris = 0 ;
-	cellProcContour( this->root, fout ) ; // a single call to root runs algorithm on entire tree
-	clock_t finish = clock();
-	printf("Time used: %f seconds.\n", (float) (finish - start) / (float) CLOCKS_PER_SEC ) ;
-	printf("Actual triangles written: %d\n", actualTris ) ;
-	fclose( fout ) ;
-}
-
-// this writes out octree vertices to the PLY file
-// each vertex gets an index, which is stored in node->index
-void Octree::generateVertexIndex( OctreeNode* node, int& offset, FILE* fout ) {
-	NodeType type = node->getType() ;
-
-	if ( type == INTERNAL ) { // Internal node, recurse into tree
-		InternalNode* inode = ( (InternalNode* ) node ) ;
-		for ( int i = 0 ; i < 8 ; i ++ ) {
-			if ( inode->child[i] != NULL )
-				generateVertexIndex( inode->child[i], offset, fout ) ;
-		}
-	}
-	else if ( type == LEAF ) { // Leaf node
-		LeafNode* lnode = ((LeafNode *) node) ;
-		PLYWriter::writeVertex( fout, lnode->mp ) ; // write out mp
-		lnode->index = offset;
-		offset++;
-	}
-	else if ( type == PSEUDOLEAF ) { // Pseudo leaf node
-		PseudoLeafNode* pnode = ((PseudoLeafNode *) node) ;
-		PLYWriter::writeVertex( fout, pnode->mp ) ; // write out mp
-		pnode->index = offset;
-		offset++;
-	}
-}
-
-// cellProcContour( this->root ) is the entry-point to the entire algorithm
-void Octree::cellProcContour( OctreeNode* node, FILE* fout )  {
-	if ( node == NULL )
-		return ;
-
-	int type = node->getType() ;
-
-	if ( type == INTERNAL ) { // internal node
-		InternalNode* inode = (( InternalNode * ) node );
-		for ( int i = 0 ; i < 8 ; i ++ ) // 8 Cell calls on children
-			cellProcContour( inode->child[ i ], fout );
-
-		for ( int i = 0 ; i < 12 ; i ++ ) {  // 12 face calls, faces between each child node
-			int c[ 2 ] = { cellProcFaceMask[ i ][ 0 ], cellProcFaceMask[ i ][ 1 ] };
-			OctreeNode* fcd[2];
-			fcd[0] = inode->child[ c[0] ] ;
-			fcd[1] = inode->child[ c[1] ] ;
-			faceProcContour( fcd, cellProcFaceMask[ i ][ 2 ], fout ) ;
-		}
-
-		for ( int i = 0 ; i < 6 ; i ++ ) {  // 6 edge calls
-			int c[ 4 ] = { cellProcEdgeMask[ i ][ 0 ], cellProcEdgeMask[ i ][ 1 ], cellProcEdgeMask[ i ][ 2 ], cellProcEdgeMask[ i ][ 3 ] };
-			OctreeNode* ecd[4] ;
-			for ( int j = 0 ; j < 4 ; j ++ )
-				ecd[j] = inode->child[ c[j] ] ;
-
-			edgeProcContour( ecd, cellProcEdgeMask[ i ][ 4 ], fout ) ;
-		}
-	}
-};
-
-// node[2] are the two nodes that share a face
-// dir comes from cellProcFaceMask[i][2]  where i=0..11
-void Octree::faceProcContour ( OctreeNode* node[2], int dir, FILE* fout )  {
-	// printf("I am at a face! %d\n", dir ) ;
-	if ( ! ( node[0] && node[1] ) ) {
-		// printf("I am none.\n") ;
-		return ;
-	}
-
-	NodeType type[2] = { node[0]->getType(), node[1]->getType() } ;
-
-	if ( type[0] == INTERNAL || type[1] == INTERNAL ) { // both nodes internal
-		// 4 face calls
-		OctreeNode* fcd[2] ;
-		for ( int i = 0 ; i < 4 ; i ++ ) {
-			int c[2] = { faceProcFaceMask[ dir ][ i ][ 0 ], faceProcFaceMask[ dir ][ i ][ 1 ] };
-			for ( int j = 0 ; j < 2 ; j ++ ) {
-				if ( type[j] > 0 )
-					fcd[j] = node[j];
-				else 
-					fcd[j] = ((InternalNode *) node[ j ] )->child[ c[j] ];
-			}
-			faceProcContour( fcd, faceProcFaceMask[ dir ][ i ][ 2 ], fout ) ;
-		}
-
-		// 4 edge calls
-		int orders[2][4] = {{ 0, 0, 1, 1 }, { 0, 1, 0, 1 }} ;
-		OctreeNode* ecd[4] ;
-			
-		for ( int i = 0 ; i < 4 ; i ++ ) {
-			int c[4] = { faceProcEdgeMask[ dir ][ i ][ 1 ], faceProcEdgeMask[ dir ][ i ][ 2 ],
-						 faceProcEdgeMask[ dir ][ i ][ 3 ], faceProcEdgeMask[ dir ][ i ][ 4 ] };
-			int* order = orders[ faceProcEdgeMask[ dir ][ i ][ 0 ] ] ;
-
-			for ( int j = 0 ; j < 4 ; j ++ ) {
-				if ( type[order[j]] > 0 )
-					ecd[j] = node[order[j]] ;
-				else
-					ecd[j] = ( (InternalNode *) node[ order[ j ] ] )->child[ c[j] ] ;
-			}
-			edgeProcContour( ecd, faceProcEdgeMask[ dir ][ i ][ 5 ], fout ) ;
-		}
-//		printf("I am done.\n") ;
-	}
-	else {
-//		printf("I don't have any children.\n") ;
-	}
-};
-
-// a common edge between four nodes in node[4]
-// "dir" comes from cellProcEdgeMask
-void Octree::edgeProcContour ( OctreeNode* node[4], int dir, FILE* fout ) {
-	if ( ! ( node[0] && node[1] && node[2] && node[3] ) )
-		return;
-
-	NodeType type[4] = { node[0]->getType(), node[1]->getType(), node[2]->getType(), node[3]->getType() } ;
-
-	if ( type[0] != INTERNAL && type[1] != INTERNAL  && type[2] != INTERNAL && type[3] != INTERNAL ) {
-		processEdgeWrite( node, dir, fout ) ; // a face (quad?) is output
-	} else {
-		// 2 edge calls
-		OctreeNode* ecd[4] ;
-		for ( int i = 0 ; i < 2 ; i ++ ) {
-			int c[ 4 ] = { edgeProcEdgeMask[ dir ][ i ][ 0 ], 
-						   edgeProcEdgeMask[ dir ][ i ][ 1 ], 
-						   edgeProcEdgeMask[ dir ][ i ][ 2 ], 
-						   edgeProcEdgeMask[ dir ][ i ][ 3 ] } ;
-
-			for ( int j = 0 ; j < 4 ; j ++ ) {
-				if ( type[j] > 0 )
-					ecd[j] = node[j] ;
-				else
-					ecd[j] = ((InternalNode *) node[j])->child[ c[j] ] ;
-			}
-
-			edgeProcContour( ecd, edgeProcEdgeMask[ dir ][ i ][ 4 ], fout ) ;
-		}
-
-	}
-};
-
-// this writes out a face to the PLY file
-// vertices already exist in the file
-// so here we write out topology only, i.e. sets of indices that form a face
-void Octree::processEdgeWrite ( OctreeNode* node[4], int dir, FILE* fout )  {
-	// Get minimal cell
-	int type, ht, minht = this->maxDepth+1, mini = -1 ;
-	int ind[4], sc[4], flip[4] = {0,0,0,0} ;
-	int flip2;
-	for ( int i = 0 ; i < 4 ; i ++ ) {
-		if ( node[i]->getType() == LEAF ) {
-			LeafNode* lnode = ((LeafNode *) node[i]) ;
-			int ed = processEdgeMask[dir][i] ;
-			int c1 = edgevmap[ed][0] ;
-			int c2 = edgevmap[ed][1] ;
-
-			if ( lnode->height < minht ) {
-				minht = lnode->height ;
-				mini = i ;
-				if ( lnode->getSign(c1) > 0 )
-					flip2 = 1 ;
-				else
-					flip2 = 0 ;
-			}
-			ind[i] = lnode->index ;
-
-			if ( lnode->getSign( c1 ) == lnode->getSign( c2 ) )
-				sc[ i ] = 0 ;
-			else
-				sc[ i ] = 1 ;
-
-//				if ( lnode->getSign(c1) > 0 )
-//				{
-//					flip[ i ] = 1 ;
-//				}
-			// }
-		} else {
-			assert( node[i]->getType() == PSEUDOLEAF );
-			PseudoLeafNode* pnode = ((PseudoLeafNode *) node[i]) ;
-
-			int ed = processEdgeMask[dir][i] ;
-			int c1 = edgevmap[ed][0] ;
-			int c2 = edgevmap[ed][1] ;
-
-			if ( pnode->height < minht ) {
-				minht = pnode->height;
-				mini = i;
-				if ( pnode->getSign(c1) > 0 )
-					flip2 = 1 ;
-				else
-					flip2 = 0 ;
-			}
-			ind[i] = pnode->index ;
-
-			if ( pnode->getSign( c1 ) == pnode->getSign( c2 ) )
-				sc[ i ] = 0 ;
-			else
-				sc[ i ] = 1 ;
-
-//				if ( pnode->getSign(c1) > 0 )
-//				{
-//					flip[ i ] = 1 ;
-//					flip2 = 1 ;
-//				}
-//			}
-		}
-
-	}
-
-	if ( sc[ mini ] == 1 ) { // condition for any triangle output?
-		if ( flip2 == 0 ) {
-			actualTris ++ ;
-			if ( ind[0] == ind[1] ) { // two indices same, so output triangle
-				int tind[] = { ind[0], ind[3], ind[2] } ;
-				PLYWriter::writeFace( fout, 3, tind ) ;
-			} else if ( ind[1] == ind[3] ) {
-				int tind[] = { ind[0], ind[1], ind[2] } ;
-				PLYWriter::writeFace( fout, 3, tind ) ;
-			} else if ( ind[3] == ind[2] ) {
-				int tind[] = { ind[0], ind[1], ind[3] } ;
-				PLYWriter::writeFace( fout, 3, tind ) ;
-			} else if ( ind[2] == ind[0] ) {
-				int tind[] = { ind[1], ind[3], ind[2] } ;
-				PLYWriter::writeFace( fout, 3, tind ) ;
-			} else { // all indices unique, so output a quad by outputting two triangles
-				int tind1[] = { ind[0], ind[1], ind[3] } ;
-				PLYWriter::writeFace( fout, 3, tind1 ) ;
-				int tind2[] = { ind[0], ind[3], ind[2] } ;
-				PLYWriter::writeFace( fout, 3, tind2 ) ;
-				actualTris ++ ; // two triangles, so add one here also
-			}
-		} else {
-			actualTris ++ ;
-			if ( ind[0] == ind[1] ) {
-				int tind[] = { ind[0], ind[2], ind[3] } ;
-				PLYWriter::writeFace( fout, 3, tind ) ;
-			} else if ( ind[1] == ind[3] ) {
-				int tind[] = { ind[0], ind[2], ind[1] } ;
-				PLYWriter::writeFace( fout, 3, tind ) ;
-			} else if ( ind[3] == ind[2] ) {
-				int tind[] = { ind[0], ind[3], ind[1] } ;
-				PLYWriter::writeFace( fout, 3, tind ) ;
-			} else if ( ind[2] == ind[0] ) {
-				int tind[] = { ind[1], ind[2], ind[3] } ;
-				PLYWriter::writeFace( fout, 3, tind ) ;
-			} else {
-				int tind1[] = { ind[0], ind[3], ind[1] } ;
-				PLYWriter::writeFace( fout, 3, tind1 ) ;
-				int tind2[] = { ind[0], ind[2], ind[3] } ;
-				PLYWriter::writeFace( fout, 3, tind2 ) ;
-				actualTris++; // two triangles, so add one here also
-			}
-		}
-	}
-};
-
-
-// used initially for counting number of vertices
-// genContour calls cellProcCount(root) and this is a recursive function
-void Octree::cellProcCount( OctreeNode* node, int& nverts, int& nfaces )  {
-	if ( node == NULL )
-		return ;
-
-	int type = node->getType() ;
-
-	if (type != INTERNAL)
-		nverts ++ ; // !internal, so leaf or pseudoleaf node produces a vertex
-	else { 
-		// recurse into tree
-		InternalNode* inode = (( InternalNode * ) node ) ;
-		
-		for ( int i = 0 ; i < 8 ; i ++ ) // 8 recursive calls to child nodes
-			cellProcCount( inode->child[ i ], nverts, nfaces ) ;
-
-		OctreeNode* fcd[2];
-		for ( int i = 0 ; i < 12 ; i ++ ) {  // 12 face calls. among the 8 child-nodes there are 12 common faces
-			int c[ 2 ] = { cellProcFaceMask[ i ][ 0 ], cellProcFaceMask[ i ][ 1 ] };
-			fcd[0] = inode->child[ c[0] ] ;
-			fcd[1] = inode->child[ c[1] ] ;
-			faceProcCount( fcd, cellProcFaceMask[ i ][ 2 ], nverts, nfaces ); // 2nd argument is "dir"
-		}
-
-		OctreeNode* ecd[4] ;
-		for ( int i = 0 ; i < 6 ; i ++ ) { // 6 edge calls
-			int c[ 4 ] = { cellProcEdgeMask[ i ][ 0 ], cellProcEdgeMask[ i ][ 1 ], cellProcEdgeMask[ i ][ 2 ], cellProcEdgeMask[ i ][ 3 ] };
-			for ( int j = 0 ; j < 4 ; j ++ )
-				ecd[j] = inode->child[ c[j] ] ;
-			edgeProcCount( ecd, cellProcEdgeMask[ i ][ 4 ], nverts, nfaces ) ;
-		}
-	}
-};
-
-void Octree::faceProcCount ( OctreeNode* node[2], int dir, int& nverts, int& nfaces ) {
-	if ( ! ( node[0] && node[1] ) ) 
-		return ;
-	
-	int type[2] = { node[0]->getType(), node[1]->getType() } ;
-
-	if ( type[0] == INTERNAL || type[1] == INTERNAL ) {
-		OctreeNode* fcd[2] ; 
-		for ( int i = 0 ; i < 4 ; i ++ ) { // 4 face calls, recursive!
-			int c[2] = { faceProcFaceMask[ dir ][ i ][ 0 ], faceProcFaceMask[ dir ][ i ][ 1 ] };
-			for ( int j = 0 ; j < 2 ; j ++ ) {
-				if ( type[j] != INTERNAL )
-					fcd[j] = node[j] ;
-				else
-					fcd[j] = ((InternalNode *) node[ j ] )->child[ c[j] ] ;
-			}
-			faceProcCount( fcd, faceProcFaceMask[ dir ][ i ][ 2 ], nverts, nfaces ) ;
-		}
-
-		int orders[2][4] = {{ 0, 0, 1, 1 }, { 0, 1, 0, 1 }} ;
-		OctreeNode* ecd[4] ;
-			
-		for ( int i = 0 ; i < 4 ; i ++ ) {  // 4 edge calls
-			int c[4] = { faceProcEdgeMask[ dir ][ i ][ 1 ], faceProcEdgeMask[ dir ][ i ][ 2 ],
-						 faceProcEdgeMask[ dir ][ i ][ 3 ], faceProcEdgeMask[ dir ][ i ][ 4 ] };
-			int* order = orders[ faceProcEdgeMask[ dir ][ i ][ 0 ] ] ;
-
-			for ( int j = 0 ; j < 4 ; j ++ ) {
-				if ( type[order[j]] != INTERNAL )
-					ecd[j] = node[order[j]] ;
-				else
-					ecd[j] = ( (InternalNode *) node[ order[ j ] ] )->child[ c[j] ] ;
-			}
-
-			edgeProcCount( ecd, faceProcEdgeMask[ dir ][ i ][ 5 ], nverts, nfaces ) ;
-		}
-	}
-};
-
-void Octree::edgeProcCount ( OctreeNode* node[4], int dir, int& nverts, int& nfaces ) {
-	if ( ! ( node[0] && node[1] && node[2] && node[3] ) )
-		return ;
-
-	int type[4] = { node[0]->getType(), node[1]->getType(), node[2]->getType(), node[3]->getType() } ;
-	if ( type[0] != INTERNAL && type[1] != INTERNAL && type[2] != INTERNAL && type[3] != INTERNAL )
-		processEdgeCount( node, dir, nverts, nfaces ) ;
-	else {
-		// 2 edge calls
-		OctreeNode* ecd[4] ;
-		for ( int i = 0 ; i < 2 ; i ++ ) {
-			int c[ 4 ] = { edgeProcEdgeMask[ dir ][ i ][ 0 ], 
-						   edgeProcEdgeMask[ dir ][ i ][ 1 ], 
-						   edgeProcEdgeMask[ dir ][ i ][ 2 ], 
-						   edgeProcEdgeMask[ dir ][ i ][ 3 ] } ;
-
-			for ( int j = 0 ; j < 4 ; j ++ ) {
-				if ( type[j] != INTERNAL )
-					ecd[j] = node[j] ;
-				else
-					ecd[j] = ((InternalNode *) node[j])->child[ c[j] ] ;
-			}
-			edgeProcCount( ecd, edgeProcEdgeMask[ dir ][ i ][ 4 ], nverts, nfaces ) ;
-		}
-	}
-};
-
-void Octree::processEdgeCount ( OctreeNode* node[4], int dir, int& nverts, int& nfaces )  {
-	// Get minimal cell
-	int i, type, ht, minht = maxDepth+1, mini = -1 ;
-	int ind[4], sc[4], flip[4] = {0,0,0,0} ;
-	for ( i = 0 ; i < 4 ; i ++ ) {
-		if ( node[i]->getType() == 1 ) {
-			LeafNode* lnode = ((LeafNode *) node[i]) ;
-
-			if ( lnode->height < minht ) {
-				minht = lnode->height ;
-				mini = i ;
-			}
-			ind[i] = lnode->index ;
-
-			int ed = processEdgeMask[dir][i] ;
-			int c1 = edgevmap[ed][0] ;
-			int c2 = edgevmap[ed][1] ;
-
-			if ( lnode->getSign( c1 ) == lnode->getSign( c2 ) ) {
-				sc[ i ] = 0 ;
-			}
-			else {
-				sc[ i ] = 1 ;
-				if ( lnode->getSign(c1) > 0 )
-					flip[ i ] = 1 ;
-			}
-		}
-		else {
-			PseudoLeafNode* pnode = ((PseudoLeafNode *) node[i]) ;
-			if ( pnode->height < minht ) {
-				minht = pnode->height ;
-				mini = i ;
-			}
-			ind[i] = pnode->index ;
-
-			int ed = processEdgeMask[dir][i] ;
-			int c1 = edgevmap[ed][0] ;
-			int c2 = edgevmap[ed][1] ;
-
-			if ( pnode->getSign( c1 ) == pnode->getSign( c2 ) ) {
-				sc[ i ] = 0 ;
-			}
-			else {
-				sc[ i ] = 1 ;
-				if ( pnode->getSign(c1) > 0 )
-					flip[ i ] = 1 ;
-			}
-		}
-	}
-
-	if ( sc[ mini ] == 1 ) {
-		nfaces ++ ; // triangle
-		if ( node[0] != node[1] && node[1] != node[3] && node[3] != node[2] && node[2] != node[0] )
-			nfaces ++ ; // quad, so two triangles
-	}
-
-};
-
-/************************************************************************/
-/* Start intersection free algorithm                               */
-/************************************************************************/
-
-
-
-int Octree::testFace( int st[3], int len, int dir, float v1[3], float v2[3] ) 
-{
-#ifdef TESS_UNIFORM
-	return 0 ;
-#endif
-
-#ifdef TESS_NONE
-	return 1 ;
-#endif
-	float vec[3] = { v2[0]-v1[0], v2[1]-v1[1], v2[2]-v1[2] } ;
-	float ax1[3], ax2[3] ;
-	float ed1[3]={0,0,0}, ed2[3] = {0,0,0};
-	ed1[(dir+1)%3]=1;
-	ed2[(dir+2)%3]=1;
-
-	Intersection::cross( ed1, vec, ax1 ) ;
-	Intersection::cross( ed2, vec, ax2 ) ;
-
-	Triangle* t1 = new Triangle ;
-	Triangle* t2 = new Triangle ;
-
-	for ( int i = 0 ; i < 3 ; i ++ )
-	{
-		t1->vt[0][i] = v1[i] ;
-		t1->vt[1][i] = v2[i] ;
-		t1->vt[2][i] = v2[i] ;
-
-		t2->vt[0][i] = st[i] ;
-		t2->vt[1][i] = st[i] ;
-		t2->vt[2][i] = st[i] ;
-	}
-	t2->vt[1][(dir+1)%3] += len ;
-	t2->vt[2][(dir+2)%3] += len ;
-
-	if ( Intersection::separating( ax1, t1, t2 ) || Intersection::separating( ax2, t1, t2 ) )
-	{
-		faceVerts ++ ;
-/*
-			printf("\n{{{%d, %d, %d},%d,%d},{{%f, %f, %f},{%f, %f, %f}}}\n",
-				st[0],st[1], st[2],
-				len, dir+1,
-				v1[0], v1[1], v1[2],
-				v2[0], v2[1], v2[2]) ;
-*/		
-		return 0 ;
-	}
-	else
-	{
-		return 1 ;
-	}
-};
-
-int Octree::testEdge( int st[3], int len, int dir, OctreeNode* node[4], float v[4][3] ) 
-{
-#ifdef TESS_UNIFORM
-	return 0 ;
-#endif
-
-#ifdef TESS_NONE
-	return 1 ;
-#endif
-
-	if ( node[0] == node[1] || node[1] == node[3] || node[3] == node[2] || node[2] == node[0] )
-	{
-//		return 1 ;
-	}
-
-	float p1[3] ={st[0], st[1], st[2]};
-	float p2[3] ={st[0], st[1], st[2]};
-	p2[dir] += len ;
-
-	int nbr[]={0,1,3,2,0} ;
-	int nbr2[]={3,2,0,1,3} ;
-	float nm[3], vec1[4][3], vec2[4][3] ;
-	float d1, d2 ;
-
-	for ( int i = 0 ; i < 4 ; i ++ )
-	{
-		for ( int j = 0 ; j < 3 ; j ++ )
-		{
-			vec1[i][j] = v[i][j] - p1[j] ;
-			vec2[i][j] = v[i][j] - p2[j] ;
-		}
-	}
-
-#ifdef EDGE_TEST_CONVEXITY
-	for ( i = 0 ; i < 4 ; i ++ )
-	{
-		int a = nbr[i] ;
-		int b = nbr[i+1] ;
-		int c = nbr2[i] ;
-		int d = nbr2[i+1] ;
-
-		if ( node[a] == node[b] )
-		{
-			continue ;
-		}
-
-		Intersection::cross( vec1[a], vec1[b], nm ) ;
-		d1 = Intersection::dot( vec1[c], nm ) ;
-		d2 = Intersection::dot( vec1[d], nm ) ;
-
-		if ( d1 * d2 < 0 )
-		{
-			/*
-			printf("1\n{{{%f, %f, %f},{%f, %f, %f}},{{%f, %f, %f},{%f, %f, %f},{%f, %f, %f},{%f, %f, %f}}}\n",
-				p1[0], p1[1], p1[2],
-				p2[0], p2[1], p2[2],
-				v[0][0], v[0][1], v[0][2],
-				v[1][0], v[1][1], v[1][2],
-				v[2][0], v[2][1], v[2][2],
-				v[3][0], v[3][1], v[3][2]) ;
-			*/
-			return 0 ;
-		}
-
-		Intersection::cross( vec2[a], vec2[b], nm ) ;
-		d1 = Intersection::dot( vec2[c], nm ) ;
-		d2 = Intersection::dot( vec2[d], nm ) ;
-
-		if ( d1 * d2 < 0 )
-		{
-			/*
-			printf("2\n{{{%f, %f, %f},{%f, %f, %f}},{{%f, %f, %f},{%f, %f, %f},{%f, %f, %f},{%f, %f, %f}}}\n",
-				p1[0], p1[1], p1[2],
-				p2[0], p2[1], p2[2],
-				v[0][0], v[0][1], v[0][2],
-				v[1][0], v[1][1], v[1][2],
-				v[2][0], v[2][1], v[2][2],
-				v[3][0], v[3][1], v[3][2]) ;
-			*/
-			return 0 ;
-		}
-	}
-#else
-#ifdef EDGE_TEST_FLIPDIAGONAL
-	Triangle* t1 = new Triangle ;
-	Triangle* t2 = new Triangle ;
-	int tri[2][2][4] = {{{0,1,3,2},{3,2,0,1}},{{2,0,1,3},{1,3,2,0}}} ;
-	for ( i = 0 ; i < 2 ; i ++ )
-	{
-		int good = 1 ;
-		for ( int j = 0 ; j < 2 ; j ++ )
-		{
-			// Top
-			for ( int k = 0 ; k < 3 ; k ++ )
-			{
-				t1->vt[0][k] = v[tri[i][j][0]][k] ;
-				t1->vt[1][k] = v[tri[i][j][1]][k] ;
-				t1->vt[2][k] = v[tri[i][j][2]][k] ;
-
-				t2->vt[0][k] = p1[k] ;
-				t2->vt[1][k] = v[tri[i][j][2]][k] ;
-				t2->vt[2][k] = v[tri[i][j][3]][k] ;
-			}
-
-			if ( Intersection::testIntersection( t1, t2 ) )
-			{
-				good = 0 ;
-				break ;
-			}
-			
-			// Bottom
-			for ( k = 0 ; k < 3 ; k ++ )
-			{
-				t2->vt[0][k] = p2[k] ;
-				t2->vt[1][k] = v[tri[i][j][2]][k] ;
-				t2->vt[2][k] = v[tri[i][j][3]][k] ;
-			}
-			
-			if ( Intersection::testIntersection( t1, t2 ) )
-			{
-				good = 0 ;
-				break ;
-			}
-		}
-
-		if ( good )
-		{
-			return (i+1) ;
-		}
-	}
-	return 0 ;
-
-#else
-#ifdef EDGE_TEST_NEW
-	Triangle* t1 = new Triangle ;
-	int tri[2][2][4] = {{{0,1,3,2},{3,2,0,1}},{{2,0,1,3},{1,3,2,0}}} ;
-	for ( int i = 0 ; i < 2 ; i ++ )
-	{
-		// For each triangulation
-		for ( int j = 0 ; j < 2 ; j ++ )
-		{
-			// Starting with each triangle
-			int k ;
-
-			// Check triangle and dual edge
-			float vec1[3], vec2[3], vec3[3], vec[3] ;
-			for ( k = 0 ; k < 3 ; k ++ )
-			{
-				t1->vt[0][k] = v[tri[i][j][0]][k] ;
-				t1->vt[1][k] = v[tri[i][j][1]][k] ;
-				t1->vt[2][k] = v[tri[i][j][2]][k] ;
-
-				vec1[k] = t1->vt[1][k] - t1->vt[0][k] ;
-				vec2[k] = t1->vt[2][k] - t1->vt[1][k] ;
-			}
-
-			float axes[3] ;
-			Intersection::cross( vec1, vec2, axes ) ;
-
-			if ( Intersection::separating( axes, t1, p1, p2 ) )
-			{
-				continue ;
-			}
-			
-			// Check diagonal and the other triangle
-			for ( k = 0 ; k < 3 ; k ++ )
-			{
-				t1->vt[0][k] = p1[k] ;
-				t1->vt[1][k] = p2[k] ;
-				t1->vt[2][k] = v[tri[i][j][3]][k] ;
-
-				vec1[k] = t1->vt[1][k] - t1->vt[0][k] ;
-				vec2[k] = t1->vt[2][k] - t1->vt[1][k] ;
-				vec3[k] = t1->vt[0][k] - t1->vt[2][k] ;
-
-				vec[k] = v[tri[i][j][2]][k] - v[tri[i][j][0]][k] ;
-			}
-
-			float axes1[3], axes2[3], axes3[3] ;
-			Intersection::cross( vec1, vec, axes1 ) ;
-			Intersection::cross( vec2, vec, axes2 ) ;
-			Intersection::cross( vec3, vec, axes3 ) ;
-
-			if ( Intersection::separating( axes1, t1, v[tri[i][j][0]], v[tri[i][j][2]] ) || 
-				 Intersection::separating( axes2, t1, v[tri[i][j][0]], v[tri[i][j][2]] ) ||
-				 Intersection::separating( axes3, t1, v[tri[i][j][0]], v[tri[i][j][2]] ) )
-			{
-				continue ;
-			}
-
-			return (i+1) ;
-		}
-	}
-	return 0 ;
-
-
-#endif
-
-#endif
-#endif
-	
-	return 1 ;
-};
-
-
-void Octree::makeEdgeVertex( int st[3], int len, int dir, OctreeNode* node[4], float mp[4][3], float v[3] ) 
-{
-	int nlen = len / 2 ;
-	v[0] = st[0] ;
-	v[1] = st[1] ;
-	v[2] = st[2] ;
-	v[dir] += nlen ;
-
-	//return ;
-
-//	if ( this->hasQEF == 0 )
-//	{
-//		return ;
-//	}
-
-
-	/* QEF based method 
-
-	int i, j ;
-	float ata[6] = { 0, 0, 0, 0, 0, 0 };
-	float atb[3] = { 0, 0, 0 } ;
-	float btb = 0 ;
-
-	// Gather QEF
-	for ( j = 0 ; j < 4 ; j ++ )
-	{
-		if ( node[j]->getType() == 1 )
-		{
-			LeafNode* lnode = ((LeafNode *) node[j]) ;
-			for ( i = 0 ; i < 6 ; i ++ )
-			{
-				ata[i] += lnode->ata[i] ;
-			}
-			for ( i = 0 ; i < 3 ; i ++ )
-			{
-				atb[i] += lnode->atb[i] ;
-			}
-			btb += lnode->btb ;
-		}
-		else
-		{
-			PseudoLeafNode* lnode = ((PseudoLeafNode *) node[j]) ;
-			for ( i = 0 ; i < 6 ; i ++ )
-			{
-				ata[i] += lnode->ata[i] ;
-			}
-			for ( i = 0 ; i < 3 ; i ++ )
-			{
-				atb[i] += lnode->atb[i] ;
-			}
-			btb += lnode->btb ;
-		}
-	}
-
-	// Find coefficient A and b
-	float A, b ;
-	switch ( dir )
-	{
-	case 0 : 
-		A = ata[ 0 ] ;
-		b = atb[ 0 ] - ata[ 1 ] * st[ 1 ] - ata[ 2 ] * st[ 2 ] ;
-		break ;
-	case 1 :
-		A = ata[ 3 ] ;
-		b = atb[ 1 ] - ata[ 1 ] * st[ 0 ] - ata[ 4 ] * st[ 2 ] ;
-		break ;
-	case 2 :
-		A = ata[ 5 ] ;
-		b = atb[ 2 ] - ata[ 2 ] * st[ 0 ] - ata[ 4 ] * st[ 1 ] ;
-		break ;
-	}
-
-	if ( A == 0 )
-	{
-		printf("A is zero!\n") ;
-		return ;
-	}
-	else
-	{
-		v[ dir ] = b / A ;
-		if ( v[ dir ] < st[ dir ] )
-		{
-			v[ dir ] = st[ dir ] ;
-		}
-		else if ( v[ dir ] > st[ dir ] + len)
-		{
-			v[ dir ] = st[ dir ] + len ;
-		}
-	}
-	*/
-
-
-	/* Barycentric approach */
-	float pt[4][2], pv[4], x[2] ;
-	int dir2 = ( dir + 1 ) % 3 ;
-	int dir3 = ( dir2 + 1 ) % 3 ;
-	int seq[] = {0,1,3,2} ;
-	float epsilon = 0.000001f;
-
-	for ( int i = 0 ; i < 4 ; i ++ )
-	{
-		pt[ i ][ 0 ] = mp[ seq[i] ][ dir2 ] ;
-		pt[ i ][ 1 ] = mp[ seq[i] ][ dir3 ] ;
-		pv[ i ] = mp[ seq[i] ][ dir ] ;
-	}
-	x[ 0 ] = st[ dir2 ] ;
-	x[ 1 ] = st[ dir3 ] ;
-
-	// Compute mean-value interpolation
-
-	float vec[4][2], d[4] ;
-	for ( int i = 0 ; i < 4 ; i ++ )
-	{
-		vec[i][0] = pt[i][0] - x[0] ;
-		vec[i][1] = pt[i][1] - x[1] ;
-
-		d[i] = sqrt( vec[i][0] * vec[i][0] + vec[i][1] * vec[i][1] );
-
-		if ( d[i] < epsilon )
-		{
-			
-			v[ dir ] = pv[ i ] ;
-			if ( v[dir] < st[dir] )
-			{
-				v[dir] = st[dir] ;
-			}
-			else if ( v[dir] > st[dir] + len )
-			{
-				v[dir] = st[dir] + len ;
-			}
-			
-			return ;
-		}
-	}
-
-	float w[4]={0,0,0,0}, totw = 0 ;
-	for ( int i = 0 ; i < 4 ; i ++ )
-	{
-		int i2 = ( i + 1 ) % 4 ;
-		float sine = ( vec[i][0] * vec[i2][1] - vec[i][1] * vec[i2][0] ) / ( d[i] * d[i2] ) ;
-		float cosine = ( vec[i][0] * vec[i2][0] + vec[i][1] * vec[i2][1] ) / ( d[i] * d[i2] ) ;
-
-		if ( fabs(cosine + 1) < epsilon )
-		{
-			v[ dir ] = ( pv[ i ] * d[i2] + pv[ i2 ] * d[i] ) / (d[i] + d[i2]);
-			
-			if ( v[dir] < st[dir] )
-			{
-				v[dir] = st[dir] ;
-			}
-			else if ( v[dir] > st[dir] + len )
-			{
-				v[dir] = st[dir] + len ;
-			}
-			
-			return ;
-		}
-
-		float tan2 = sine / ( 1 + cosine ) ;
-
-		w[i] += ( tan2 / d[i] ) ; 
-		w[i2] += ( tan2 / d[i2] ) ; 
-
-		totw += ( tan2 / d[i] ) ;
-		totw += ( tan2 / d[i2] ) ;
-	}
-
-	v[dir] = 0 ;
-	for ( int i = 0 ; i < 4 ; i ++ )
-	{
-		v[dir] += ( w[i] * pv[ i ] / totw );
-	}
-	/**/
-	if ( v[dir] < st[dir] )
-	{
-		v[dir] = st[dir] ;
-	}
-	else if ( v[dir] > st[dir] + len )
-	{
-		v[dir] = st[dir] + len ;
-	}
-	
-};
-
-
-void Octree::cellProcContourNoInter2( OctreeNode* node, int st[3], int len, 
-HashMap* hash, IndexedTriangleList* tlist, int& numTris, VertexList* vlist, int& numVerts )
-{
-//	printf("I am at a cell! %d %d %d, %d \n", st[0], st[1], st[2], len ) ;	
-	if ( node == NULL )
-	{
-//		printf("Empty cell.\n") ;
-		return ;
-	}
-
-	int type = node->getType() ;
-
-	if ( type == 0 )
-	{
-		InternalNode* inode = (( InternalNode * ) node ) ;
-
-		// 8 Cell calls
-//			printf("Process cell calls!\n") ;
-		int nlen = len / 2 ;
-		int nst[3] ;
-
-		for ( int i = 0 ; i < 8 ; i ++ )
-		{
-//			printf("Cell %d..\n", i) ;
-			nst[0] = st[0] + vertMap[i][0] * nlen ;
-			nst[1] = st[1] + vertMap[i][1] * nlen ;
-			nst[2] = st[2] + vertMap[i][2] * nlen ;
-			cellProcContourNoInter2( inode->child[ i ], nst, nlen, hash, tlist, numTris, vlist, numVerts ) ;
-//		printf("Return from %d %d %d, %d \n", nst[0], nst[1], nst[2], nlen ) ;	
-		}
-//					printf("I am done with cells!\n") ;
-
-		// 12 face calls
-//			printf("Process face calls!\n") ;
-		OctreeNode* fcd[2] ;
-		int dirCell2[3][4][3] = {
-			{{0,-1,-1},{0,-1,0},{0,0,-1},{0,0,0}},
-			{{-1,0,-1},{0,0,-1},{-1,0,0},{0,0,0}},
-			{{-1,-1,0},{-1,0,0},{0,-1,0},{0,0,0}}};
-		for ( int i = 0 ; i < 3 ; i ++ )
-			for ( int j = 0 ; j < 4 ; j ++ )
-			{
-				nst[0] = st[0] + nlen + dirCell2[i][j][0] * nlen ;
-				nst[1] = st[1] + nlen + dirCell2[i][j][1] * nlen ;
-				nst[2] = st[2] + nlen + dirCell2[i][j][2] * nlen ;
-				
-				int ed = i * 4 + j ;
-				int c[ 2 ] = { cellProcFaceMask[ ed ][ 0 ], cellProcFaceMask[ ed ][ 1 ] };
-				
-				fcd[0] = inode->child[ c[0] ] ;
-				fcd[1] = inode->child[ c[1] ] ;
-				
-				faceProcContourNoInter2( fcd, nst, nlen, cellProcFaceMask[ ed ][ 2 ], hash, tlist, numTris, vlist, numVerts ) ;
-			}
-//					printf("I am done with faces!\n") ;
-
-		// 6 edge calls
-//			printf("Process edge calls!\n") ;
-		OctreeNode* ecd[4] ;
-		for ( int i = 0 ; i < 6 ; i ++ )
-		{
-			int c[ 4 ] = { cellProcEdgeMask[ i ][ 0 ], cellProcEdgeMask[ i ][ 1 ], cellProcEdgeMask[ i ][ 2 ], cellProcEdgeMask[ i ][ 3 ] };
-
-			for ( int j = 0 ; j < 4 ; j ++ )
-			{
-				ecd[j] = inode->child[ c[j] ] ;
-			}
-
-			int dir = cellProcEdgeMask[ i ][ 4 ] ;
-			nst[0] = st[0] + nlen ;
-			nst[1] = st[1] + nlen ;
-			nst[2] = st[2] + nlen ;
-			if ( i % 2 == 0 )
-			{
-				nst[ dir ] -= nlen ;
-			}
-
-			edgeProcContourNoInter2( ecd, nst, nlen, dir, hash, tlist, numTris, vlist, numVerts ) ;
-		}
-//					printf("I am done with edges!\n") ;
-
-	}
-//	printf("I am done with cell %d %d %d, %d \n", st[0], st[1], st[2], len ) ;	
-};
-
-void Octree::faceProcContourNoInter2( OctreeNode* node[2], int st[3], int len, int dir, HashMap* hash, IndexedTriangleList* tlist, int& numTris, VertexList* vlist, int& numVerts )
-{
-//	printf("I am at a face! %d %d %d, %d, %d\n", st[0], st[1], st[2], len, dir ) ;
-	if ( ! ( node[0] && node[1] ) )
-	{
-//		printf("I am none.\n") ;
-		return ;
-	}
-
-	int type[2] = { node[0]->getType(), node[1]->getType() } ;
-
-	if ( type[0] == 0 || type[1] == 0 )
-	{
-		int i, j ;
-		int nlen = len / 2 ;
-		int nst[3] ;
-
-		// 4 face calls
-		OctreeNode* fcd[2] ;
-		int iface = faceProcFaceMask[ dir ][ 0 ][ 0 ] ;
-		for ( i = 0 ; i < 4 ; i ++ )
-		{
-			int c[2] = { faceProcFaceMask[ dir ][ i ][ 0 ], faceProcFaceMask[ dir ][ i ][ 1 ] };
-			for ( int j = 0 ; j < 2 ; j ++ )
-			{
-				if ( type[j] > 0 )
-				{
-					fcd[j] = node[j] ;
-				}
-				else
-				{
-					fcd[j] = ((InternalNode *) node[ j ] )->child[ c[j] ] ;
-				}
-			}
-
-			nst[0] = st[0] + nlen * ( vertMap[ c[ 0 ] ][ 0 ] - vertMap[ iface ][ 0 ] );
-			nst[1] = st[1] + nlen * ( vertMap[ c[ 0 ] ][ 1 ] - vertMap[ iface ][ 1 ] );
-			nst[2] = st[2] + nlen * ( vertMap[ c[ 0 ] ][ 2 ] - vertMap[ iface ][ 2 ] );
-
-			faceProcContourNoInter2( fcd, nst, nlen, faceProcFaceMask[ dir ][ i ][ 2 ], hash, tlist, numTris, vlist, numVerts ) ;
-		}
-
-
-		// 4 edge calls
-		int orders[2][4] = {{ 0, 0, 1, 1 }, { 0, 1, 0, 1 }} ;
-		OctreeNode* ecd[4] ;
-			
-		for ( i = 0 ; i < 4 ; i ++ )
-		{
-			int c[4] = { faceProcEdgeMask[ dir ][ i ][ 1 ], faceProcEdgeMask[ dir ][ i ][ 2 ],
-						 faceProcEdgeMask[ dir ][ i ][ 3 ], faceProcEdgeMask[ dir ][ i ][ 4 ] };
-			int* order = orders[ faceProcEdgeMask[ dir ][ i ][ 0 ] ] ;
-
-			for ( int j = 0 ; j < 4 ; j ++ )
-			{
-				if ( type[order[j]] > 0 )
-				{
-					ecd[j] = node[order[j]] ;
-				}
-				else
-				{
-					ecd[j] = ( (InternalNode *) node[ order[ j ] ] )->child[ c[j] ] ;
-				}
-			}
-
-			int ndir = faceProcEdgeMask[ dir ][ i ][ 5 ] ;
-			nst[0] = st[0] + nlen ;
-			nst[1] = st[1] + nlen ;
-			nst[2] = st[2] + nlen ;
-			nst[dir] -= nlen ;
-			if ( i % 2 == 0 )
-			{
-				nst[ ndir ] -= nlen ;
-			}
-
-			edgeProcContourNoInter2( ecd, nst, nlen, ndir, hash, tlist, numTris, vlist, numVerts ) ;
-		}
-//		printf("I am done.\n") ;
-	}
-	else
-	{
-//		printf("i don't have children.\n");
-	}
-};
-
-void Octree::edgeProcContourNoInter2( OctreeNode* node[4], int st[3], int len, int dir, HashMap* hash, IndexedTriangleList* tlist, int& numTris, VertexList* vlist, int& numVerts )
-{
-//	printf("I am at an edge! %d %d %d \n", st[0], st[1], st[2] ) ;
-	if ( ! ( node[0] && node[1] && node[2] && node[3] ) )
-	{
-//		printf("I am done!\n") ;
-		return ;
-	}
-
-	int type[4] = { node[0]->getType(), node[1]->getType(), node[2]->getType(), node[3]->getType() } ;
-
-	if ( type[0] > 0 && type[1] > 0 && type[2] > 0 && type[3] > 0 )
-	{
-		this->processEdgeNoInter2( node, st, len, dir, hash, tlist, numTris, vlist, numVerts ) ;
-	}
-	else
-	{
-		int i, j ;
-		int nlen = len / 2 ;
-		int nst[3] ;
-
-		// 2 edge calls
-		OctreeNode* ecd[4] ;
-		for ( i = 0 ; i < 2 ; i ++ )
-		{
-			int c[ 4 ] = { edgeProcEdgeMask[ dir ][ i ][ 0 ], 
-						   edgeProcEdgeMask[ dir ][ i ][ 1 ], 
-						   edgeProcEdgeMask[ dir ][ i ][ 2 ], 
-						   edgeProcEdgeMask[ dir ][ i ][ 3 ] } ;
-
-			for ( int j = 0 ; j < 4 ; j ++ )
-			{
-				if ( type[j] > 0 )
-				{
-					ecd[j] = node[j] ;
-				}
-				else
-				{
-					ecd[j] = ((InternalNode *) node[j])->child[ c[j] ] ;
-				}
-			}
-
-			nst[0] = st[0] ;
-			nst[1] = st[1] ;
-			nst[2] = st[2] ;
-			nst[dir] += nlen * i ;
-
-			edgeProcContourNoInter2( ecd, nst, nlen, edgeProcEdgeMask[ dir ][ i ][ 4 ], hash, tlist, numTris, vlist, numVerts ) ;
-		}
-
-	}
-//		printf("I am done!\n") ;
-};
-
-
-void Octree::processEdgeNoInter2( OctreeNode* node[4], int st[3], int len, int dir, HashMap* hash, IndexedTriangleList* tlist, int& numTris, VertexList* vlist, int& numVerts )
-{
-//	printf("I am at a leaf edge! %d %d %d\n", st[0], st[1], st[2] ) ;
-	// Get minimal cell
-	int i, type, minht = maxDepth+1, mini = -1 ;
-	int ind[4], sc[4], ht[4], flip=0;
-	float mp[4][3] ;
-	for ( i = 0 ; i < 4 ; i ++ ) {
-		if ( node[i]->getType() == LEAF ) {
-			LeafNode* lnode = ((LeafNode *) node[i]) ;
-			ht[i] = lnode->height ;
-			mp[i][0] = lnode->mp[0] ;
-			mp[i][1] = lnode->mp[1] ;
-			mp[i][2] = lnode->mp[2] ;
-
-
-			int ed = processEdgeMask[dir][i] ;
-			int c1 = edgevmap[ed][0] ;
-			int c2 = edgevmap[ed][1] ;
-
-			if ( lnode->height < minht ) {
-				minht = lnode->height ;
-				mini = i ;
-				if ( lnode->getSign(c1) > 0 )
-					flip = 1 ;
-				else
-					flip = 0 ;
-			}
-			ind[i] = lnode->index ;
-			if ( ind[i] < 0 )
-			{
-				// Create new index
-				VertexList* nv = new VertexList ;
-				nv->vt[0] = lnode->mp[0] ;
-				nv->vt[1] = lnode->mp[1] ;
-				nv->vt[2] = lnode->mp[2] ;
-				nv->next = vlist->next ;
-				vlist->next = nv ;
-				ind[i] = numVerts ;
-				lnode->index = numVerts ;
-				numVerts ++ ;
-			}
-
-			if ( lnode->getSign( c1 ) == lnode->getSign( c2 ) )
-				sc[ i ] = 0 ;
-			else
-				sc[ i ] = 1 ;
-		}
-		else if ( node[i]->getType() == PSEUDOLEAF ) {
-			PseudoLeafNode* pnode = ((PseudoLeafNode *) node[i]) ;
-			ht[i] = pnode->height ;
-			mp[i][0] = pnode->mp[0] ;
-			mp[i][1] = pnode->mp[1] ;
-			mp[i][2] = pnode->mp[2] ;
-
-			int ed = processEdgeMask[dir][i] ;
-			int c1 = edgevmap[ed][0] ;
-			int c2 = edgevmap[ed][1] ;
-
-			if ( pnode->height < minht )
-			{
-				minht = pnode->height ;
-				mini = i ;
-				if ( pnode->getSign(c1) > 0 )
-					flip = 1 ;
-				else
-					flip = 0 ;
-
-			}
-			ind[i] = pnode->index ;
-			if ( ind[i] < 0 ) {
-				// Create new index
-				VertexList* nv = new VertexList ;
-				nv->vt[0] = pnode->mp[0] ;
-				nv->vt[1] = pnode->mp[1] ;
-				nv->vt[2] = pnode->mp[2] ;
-				nv->next = vlist->next ;
-				vlist->next = nv ;
-				ind[i] = numVerts ;
-				pnode->index = numVerts ;
-				numVerts ++ ;
-			}
-
-			if ( pnode->getSign( c1 ) == pnode->getSign( c2 ) )
-				sc[ i ] = 0 ;
-			else
-				sc[ i ] = 1 ;
-		}
-		else {
-			printf("Wrong!\n");
-		}
-
-	}
-
-	if ( sc[ mini ] == 0 )
-	{
-//		printf("I am done!\n" ) ;
-		return ;
-	}
-
-	/************************************************************************/
-	/* Performing test                                                      */
-	/************************************************************************/
-
-	int fverts[4] ;
-	int hasFverts[4] = { 0, 0, 0, 0 } ;
-	int evert ;
-	int needTess = 0 ;
-	int location[4] ;
-	int nvert[4] ={0,0,0,0};
-	
-	
-
-	// First, face test
-	int nbr[4][2] = { {0,1},{1,3},{2,3},{0,2} };
-	int fdir[3][4] = {
-		{2,1,2,1},
-		{0,2,0,2},
-		{1,0,1,0}};
-	int dir3[3][4][2] = {
-		{{1, -1},{2, 0},{1, 0},{2, -1}},
-		{{2, -1},{0, 0},{2, 0},{0, -1}},
-		{{0, -1},{1, 0},{0, 0},{1, -1}} };
-
-	for ( i = 0 ; i < 4 ; i ++ )
-	{
-		int a = nbr[i][0];
-		int b = nbr[i][1] ;
-
-#ifndef TESS_UNIFORM
-		if ( ht[a] != ht[b] )
-#endif
-		{
-			// Different level, check if the dual edge passes through the face
-			if ( hash->FindKey( (ptr_type) (node[a]), (ptr_type)(node[b]), fverts[i], location[i] ) )
-			{
-				// The vertex was found previously
-				founds++ ;
-				hasFverts[i] = 1 ;
-				nvert[i] = 0 ;
-				needTess = 1 ;
-			}
-			else
-			{
-				// Otherwise, we test it here
-				int sht = ( ht[a] > ht[b] ? ht[b] : ht[a] ) ;
-				int flen = ( 1 << sht ) ;
-				int fst[3] ;
-
-				fst[ fdir[dir][i] ] = st[ fdir[dir][i] ] ;
-				fst[ dir3[dir][i][0] ] = st[ dir3[dir][i][0] ] + flen * dir3[dir][i][1] ;
-				fst[ dir ] = st[ dir ] - ( st[ dir ] & (( 1 << sht ) - 1 ) ) ;
-
-				if ( testFace( fst, flen, fdir[dir][i], mp[a], mp[b] ) == 0 )
-				{
-					// Dual edge does not pass face, let's make a new vertex
-					VertexList* nv = new VertexList ;
-					nv->vt[0] = 0 ;
-					nv->vt[1] = 0 ;
-					nv->vt[2] = 0 ;
-					nv->next = vlist->next ;
-					vlist->next = nv ;
-					fverts[i] = numVerts ;
-					location[i] = ((ptr_type) nv) ;
-					nvert[i] = 1 ;
-					numVerts ++ ;
-
-					hash->InsertKey( (ptr_type)(node[a]), (ptr_type)(node[b]), fverts[i], location[i] ) ;
-
-
-					hasFverts[ i ] = 1 ;
-					needTess = 1 ;
-					news ++ ;
-				}
-			}
-		}
-	}
-
-	// Next, edge test
-	int diag = 1 ;
-	if ( needTess == 0 )
-	{
-		// Even if all dual edges pass through faces, the dual complex of an edge may not be convex
-		//int st2[3] = { st[0], st[1], st[2] } ;
-		//st2[ dir ] += len ;
-
-		diag = testEdge( st, len, dir, node, mp ) ;
-		if ( diag == 0 )
-		{
-			// When this happens, we need to create an extra vertex on the primal edge
-			needTess = 1 ;
-		}
-	}
-
-	float cent[3] ;
-	if ( needTess )
-	{
-		edgeVerts ++ ;
-		makeEdgeVertex( st, len, dir, node, mp, cent ) ;
-
-		/* Just take centroid
-		int num = 0 ;
-		evert[0] = st[0] ;
-		evert[1] = st[1] ;
-		evert[2] = st[2] ;
-		evert[dir] = 0 ;
-		for ( i = 0 ; i < 4 ; i ++ )
-		{
-			evert[dir] += mp[i][dir] ;
-			num ++ ;
-
-			if ( hasFverts[ i ] )
-			{
-				evert[dir] += fverts[i][dir] ;
-				num ++ ;
-			}
-		}
-		evert[dir] /= num ;
-		*/
-
-/*
-		if ( evert[dir] < st[dir] )
-		{
-			evert[dir] = st[dir] ;
-		}
-		else if ( evert[dir] > st[dir] + len )
-		{
-			evert[dir] = st[dir] + len ;
-		}
-*/		
-
-		VertexList* nv = new VertexList ;
-		nv->vt[0] = cent[0] ;
-		nv->vt[1] = cent[1] ;
-		nv->vt[2] = cent[2] ;
-		nv->next = vlist->next ;
-		vlist->next = nv ;
-		evert = numVerts ;
-		numVerts ++ ;
-
-	}
-
-	int flipped[3];
-	if ( flip == 0 )
-	{
-		for (i = 0 ;i < 3 ; i ++)
-		{
-			flipped[i] = i ;
-		}
-	}
-	else
-	{
-		for (i = 0 ;i < 3 ; i ++)
-		{
-			flipped[i] = 2 - i ;
-		}
-	}
-
-
-
-	// Finally, let's output triangle
-	if ( needTess == 0 )
-	{
-		// Normal splitting of quad
-		if ( diag == 1 )
-		{
-			if ( node[0] != node[1] && node[1] != node[3] )
-			{
-				int tind1[]={0,1,3} ;
-				
-				numTris ++ ;
-				IndexedTriangleList* t1 = new IndexedTriangleList ;
-				t1->next = tlist->next;
-				tlist->next = t1 ;
-				for ( int j = 0 ; j < 3 ; j ++ )
-				{
-					t1->vt[flipped[j]] = ind[ tind1[j] ] ;
-				}
-			}
-			
-			if ( node[3] != node[2] && node[2] != node[0] )
-			{
-				int tind2[]={3,2,0} ;
-				
-				numTris ++ ;
-				IndexedTriangleList* t2 = new IndexedTriangleList ;
-				t2->next = tlist->next;
-				tlist->next = t2 ;
-				for ( int j = 0 ; j < 3 ; j ++ )
-				{
-					t2->vt[flipped[j]] = ind[ tind2[j] ] ;
-				}
-			}
-		}
-		else
-		{
-			if ( node[0] != node[1] && node[1] != node[2] )
-			{
-				int tind1[]={0,1,2} ;
-				
-				
-				numTris ++ ;
-				IndexedTriangleList* t1 = new IndexedTriangleList ;
-				t1->next = tlist->next;
-				tlist->next = t1 ;
-				for ( int j = 0 ; j < 3 ; j ++ )
-				{
-					t1->vt[flipped[j]] = ind[ tind1[j] ] ;
-				}
-			}
-			
-			if ( node[1] != node[3] && node[3] != node[2] )
-			{
-				int tind2[]={1,3,2} ;
-				
-				numTris ++ ;
-				IndexedTriangleList* t2 = new IndexedTriangleList ;
-				t2->next = tlist->next;
-				tlist->next = t2 ;
-				for ( int j = 0 ; j < 3 ; j ++ )
-				{
-					t2->vt[flipped[j]] = ind[ tind2[j] ] ;
-				}
-			}
-		}
-		
-	}
-	
-	else
-	{/*
-		if ( flip == 1 )
-		{
-			int tempind[4]={ind[0], ind[2], ind[1], ind[3]};
-			OctreeNode* tempnode[4] = {node[0], node[2], node[1], node[3]};
-			int tempfverts[4]={fverts[3], fverts[2], fverts[1], fverts[0]};
-			int temphasFverts[4]={hasFverts[3], hasFverts[2], hasFverts[1], hasFverts[0]};
-			int templocation[4]={location[3], location[2], location[1], location[0]};
-			int tempnvert[4]={nvert[3], nvert[2], nvert[1], nvert[0]};
-
-			for ( i = 0 ; i < 4 ; i ++ )
-			{
-				ind[i] = tempind[i] ;
-				node[i] = tempnode[i] ;
-				fverts[i] = tempfverts[i] ;
-				hasFverts[i] = temphasFverts[i] ;
-				location[i] = templocation[i] ;
-				nvert[i] = tempnvert[i] ;
-			}
-		}	
-		*/
-		int nnbr[4][2] = { {0,1},{1,3},{3,2},{2,0} };
-
-		// Center-splitting
-		for ( i = 0 ; i < 4 ; i ++ )
-		{
-			int a = nnbr[i][0];
-			int b = nnbr[i][1] ;
-
-			if ( hasFverts[ i ] )
-			{
-				// Further split each triangle into two
-				numTris += 2 ;
-
-				IndexedTriangleList* t = new IndexedTriangleList ;
-				t->next = tlist->next;
-				tlist->next = t ;
-					t->vt[flipped[0]] = ind[ a ] ;
-					t->vt[flipped[1]] = fverts[ i ] ;
-					t->vt[flipped[2]] = evert ;
-
-				t = new IndexedTriangleList ;
-				t->next = tlist->next;
-				tlist->next = t ;
-					t->vt[flipped[0]] = evert ;
-					t->vt[flipped[1]] = fverts[ i ] ;
-					t->vt[flipped[2]] = ind[ b ] ;
-
-				// Update geometric location of the face vertex
-				VertexList* nv = ((VertexList *) location[i]) ;
-				if ( nvert[i] )
-				{
-					nv->vt[0] = cent[0] ;
-					nv->vt[1] = cent[1] ;
-					nv->vt[2] = cent[2] ;
-				}
-				else
-				{
-					nv->vt[0] = ( nv->vt[0] + cent[0] ) / 2 ;
-					nv->vt[1] = ( nv->vt[1] + cent[1] ) / 2 ;
-					nv->vt[2] = ( nv->vt[2] + cent[2] ) / 2 ;
-				}
-			}
-			else
-			{
-				// For one triangle with center vertex
-				if ( node[a] != node[b] )
-				{
-					numTris ++ ;
-					IndexedTriangleList* t = new IndexedTriangleList ;
-					t->next = tlist->next;
-					tlist->next = t ;
-						t->vt[flipped[0]] = ind[ a ] ;
-						t->vt[flipped[1]] = ind[ b ] ;
-						t->vt[flipped[2]] = evert ;
-				}
-			}
-		}
-	}
-//		printf("I am done!\n" ) ;
-	
-};
+/*
+
+  Implementations of Octree member functions.
+
+  Copyright (C) 2011  Tao Ju
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public License
+  (LGPL) as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <iostream>
+#include <functional>
+#include <queue>
+#include <cassert>
+
+#include "octree.hpp"
+#include "PLYWriter.hpp"
+#include "MappedFile.hpp"
+#include "Parallel.hpp"
+
+
+Octree::Octree( char* fname,  double threshold, OctreeOptions opts )
+{
+	simplify_threshold = threshold;
+	this->opts = opts;
+	this->fullRoot = NULL ;
+	this->streamThreshold = -1 ;
+	if ( opts.streamSimplify && threshold > 0 ) {
+		// leaves that may be collapsed before the reader is done can not wait in a batch
+		this->opts.lazyQEF = 1 ;
+		this->streamThreshold = threshold ;
+	}
+	// Recognize file format
+	/*
+	if ( strstr( fname, ".sog" ) != NULL || strstr( fname, ".SOG" ) != NULL ) {
+		printf("Reading SOG file format.\n") ;
+		this->hasQEF = 0 ;
+		readSOG( fname ) ;
+	}*/
+	if ( strstr( fname, ".dcf2" ) != NULL || strstr( fname, ".DCF2" ) != NULL ) {
+		printf("Reading DCF2 file format.\n") ;
+		this->hasQEF = 1 ;
+		readDCF( fname ) ;
+	}
+	else if ( strstr( fname, ".dcf" ) != NULL || strstr( fname, ".DCF" ) != NULL ) {
+		printf("Reading DCF file format.\n") ;
+		this->hasQEF = 1 ;
+		readDCF( fname ) ;
+	}
+	else {
+		printf("Wrong input format. Must be SOG/DCF.\n");
+		exit(0) ;
+	}
+
+}
+
+// all nodes are freed at once with their arenas
+Octree::~Octree( )
+{
+	for ( size_t i = 0 ; i < arenas.size( ) ; i ++ )
+		delete arenas[i] ;
+}
+
+NodeArena* Octree::nodeArena( int worker )
+{
+	if ( (int) arenas.size( ) <= worker )
+		reserveArenas( worker + 1 ) ;
+	return arenas[ worker ] ;
+}
+
+QEFPool::Cursor& Octree::qefCursor( int worker )
+{
+	if ( (int) qefCursors.size( ) <= worker )
+		reserveArenas( worker + 1 ) ;
+	return qefCursors[ worker ] ;
+}
+
+// make sure there is an arena for each of n workers
+void Octree::reserveArenas( int n )
+{
+	while ( (int) arenas.size( ) < n )
+		arenas.push_back( new NodeArena( ) ) ;
+	if ( (int) qefCursors.size( ) < n )
+		qefCursors.resize( n ) ;
+	if ( (int) pending.size( ) < n )
+		pending.resize( n ) ;
+}
+
+// a node removed from the tree by simplify(), its children are not touched
+void Octree::recycleNode( OctreeNode* node, int worker )
+{
+	if ( ! opts.recycleNodes )
+		return ; // stays in the arena until the tree is freed
+	switch ( node->getType() ) {
+		case INTERNAL:
+			nodeArena( worker )->recycle( node, sizeof( InternalNode ) ) ;
+			break ;
+		case LEAF:
+			if ( ((LeafNode*) node)->qef != QEFPool::NONE )
+				qefPool.recycle( qefCursor( worker ), ((LeafNode*) node)->qef ) ;
+			nodeArena( worker )->recycle( node, sizeof( LeafNode ) ) ;
+			break ;
+		case PSEUDOLEAF:
+			if ( ((PseudoLeafNode*) node)->qef != QEFPool::NONE )
+				qefPool.recycle( qefCursor( worker ), ((PseudoLeafNode*) node)->qef ) ;
+			nodeArena( worker )->recycle( node, sizeof( PseudoLeafNode ) ) ;
+			break ;
+	}
+}
+
+void Octree::printMemoryStats( ) {
+	size_t blockBytes = 0, usedBytes = 0, numAllocs = 0, numRecycled = 0, numReused = 0 ;
+	for ( size_t i = 0 ; i < arenas.size( ) ; i ++ ) {
+		blockBytes += arenas[i]->blockBytes ;
+		usedBytes += arenas[i]->usedBytes ;
+		numAllocs += arenas[i]->numAllocs ;
+		numRecycled += arenas[i]->numRecycled ;
+		numReused += arenas[i]->numReused ;
+	}
+	printf(" Node memory: %lu bytes allocated, %lu bytes in use, %lu nodes made, %lu recycled, %lu reused\n", 
+		(unsigned long) blockBytes, (unsigned long) usedBytes, (unsigned long) numAllocs, 
+		(unsigned long) numRecycled, (unsigned long) numReused ) ;
+
+	printf(" QEF memory: %lu bytes allocated, %lu bytes released\n", 
+		(unsigned long) qefPool.bytes( ), (unsigned long) qefPool.releasedBytes ) ;
+}
+
+// the QEFs are only read by simplify(), so they can go before contouring
+void Octree::releaseQEF( ) {
+	if ( ! this->hasQEF )
+		return ;
+	size_t bytes = qefPool.bytes( ) ;
+	qefPool.release( ) ;
+	for ( size_t i = 0 ; i < qefCursors.size( ) ; i ++ )
+		qefCursors[i] = QEFPool::Cursor( ) ;
+	this->hasQEF = 0 ;
+	printf("Released %lu bytes of QEF data\n", (unsigned long) bytes ) ;
+}
+
+void Octree::simplify( float thresh ) {
+	if ( this->hasQEF ) {
+		int st[3] = {0,0,0} ;
+		int nthreads = Parallel::numThreads( opts.numThreads ) ;
+		if ( nthreads <= 1 ) {
+			this->root = simplify( this->root, st, this->dimen, thresh, 0, NULL ) ;
+			return ;
+		}
+		reserveArenas( nthreads ) ; // each worker recycles into and makes nodes from its own arena
+		long tasks = 0, stolen = 0 ;
+		TaskPool::run( nthreads, [&]( TaskPool& pool, int worker ) {
+			this->root = simplify( this->root, st, this->dimen, thresh, worker, &pool ) ;
+		}, &tasks, &stolen ) ;
+		printf(" Simplified on %d threads, %ld tasks, %ld stolen\n", nthreads, tasks, stolen ) ;
+	}
+}
+
+// simplify by collapsing nodes where the parent node QEF solution is good enough.
+// With a TaskPool the children of nodes of at least opts.simplifyGrain cells are
+// simplified as separate tasks, worker is the thread running this call.
+// The children are still combined in the same order, so the result does not
+// depend on the number of threads.
+OctreeNode* Octree::simplify( OctreeNode* node, int st[3], int len, float thresh, int worker, TaskPool* pool ) {
+	if ( node == NULL )
+		return NULL ;
+	if ( node->getType() != INTERNAL )
+		return node ;
+
+	InternalNode* inode = (InternalNode*)node ;
+	int nlen = len / 2 ;
+	int nst[3] ;
+	if ( pool != NULL && len >= opts.simplifyGrain ) { // recurse into tree, one task per child
+		TaskPool::Group children ;
+		for ( int i = 0 ; i < 8 ; i ++ ) {
+			if ( inode->child[i] == NULL )
+				continue ;
+			pool->spawn( worker, children, [=]( int w ) {
+				int cst[3] = { st[0] + vertMap[i][0] * nlen, st[1] + vertMap[i][1] * nlen, st[2] + vertMap[i][2] * nlen } ;
+				inode->child[i] = simplify( inode->child[i], cst, nlen, thresh, w, pool ) ;
+			} ) ;
+		}
+		pool->wait( worker, children ) ;
+	}
+	else {
+		for ( int i = 0 ; i < 8 ; i ++ ) { // recurse into tree
+			nst[0] = st[0] + vertMap[i][0] * nlen ;
+			nst[1] = st[1] + vertMap[i][1] * nlen ;
+			nst[2] = st[2] + vertMap[i][2] * nlen ;
+
+			inode->child[i] = simplify( inode->child[i], nst, nlen, thresh, worker, pool ) ;
+		}
+	}
+
+	return collapseNode( inode, st, len, thresh, worker ) ;
+}
+
+// collapse inode, whose children are simplified already, if the merged QEF
+// solution is good enough. Returns what takes the place of inode.
+OctreeNode* Octree::collapseNode( InternalNode* inode, int st[3], int len, float thresh, int worker ) {
+	OctreeNode* node = inode ;
+	for ( int i = 0 ; i < 8 ; i ++ ) {
+		if ( inode->child[i] != NULL && inode->child[i]->getType() == INTERNAL )
+			return node ; // a child could not be collapsed
+	}
+
+	MergedQEF m ;
+	mergeChildren( inode->child, st, len, m ) ;
+	if ( m.count == 0 ) { // no children left
+		recycleNode( node, worker ) ;
+		return NULL ;
+	}
+	if ( m.error <= thresh ) { // if parent QEF solution is good enough
+		for ( int i = 0 ; i < 8 ; i ++ ) {
+			if ( inode->child[i] != NULL )
+				recycleNode( inode->child[i], worker ) ;
+		}
+		recycleNode( inode, worker ) ;
+		return makePseudoLeaf( m, worker ) ;
+	}
+	return node ; // QEF solution not good enough
+}
+
+// sum the QEFs of child[8], which are leaves, pseudo-leaves or NULL, and solve
+// the result for the cell at st of size len
+void Octree::mergeChildren( OctreeNode* child[8], int st[3], int len, MergedQEF& m ) {
+	// QEF data
+	float* ata = m.q.ata ;
+	float* atb = m.q.atb ;
+	float& btb = m.q.btb ;
+	float pt[3] = { 0, 0, 0 } ;
+	int signs[8] = {-1,-1,-1,-1,-1,-1,-1,-1} ;
+	int midsign = -1 ;
+	int ec = 0 ;
+	int ht ;
+
+	for ( int i = 0 ; i < 8 ; i ++ ) {
+		if ( child[i] == NULL )
+			continue ;
+		if ( child[i]->getType() == LEAF ) { // sum child leaf QEFs
+			LeafNode* lnode = (LeafNode *) child[i] ;
+			QEFData q = qefPool.get( lnode->qef ) ;
+			ht = lnode->height ;
+
+			for ( int j = 0 ; j < 6 ; j ++ )
+				ata[j] += q.ata[j] ; 
+
+			for ( int j = 0 ; j < 3 ; j ++ ) {
+				atb[j] += q.atb[j] ;
+				pt[j] += lnode->mp[j] ;
+			}
+			if ( lnode->mp[0] == 0 )
+				printf("%f %f %f, Height: %d\n", lnode->mp[0], lnode->mp[1], lnode->mp[2], ht) ;
+
+			btb += q.btb ;
+			ec++ ; // QEF count (?)
+
+			midsign = lnode->getSign( 7 - i ) ;
+			signs[i] = lnode->getSign( i ) ;
+		}
+		else { // pseudoleaf
+			assert( child[i]->getType() == PSEUDOLEAF );
+			PseudoLeafNode* pnode = (PseudoLeafNode *) child[i];
+			QEFData q = qefPool.get( pnode->qef ) ;
+			ht = pnode->height ;
+
+			for ( int j = 0 ; j < 6 ; j ++ )
+				ata[j] += q.ata[j] ;
+
+			for ( int j = 0 ; j < 3 ; j ++ ) {
+				atb[j] += q.atb[j] ;
+				pt[j] += pnode->mp[j] ;
+			}
+			btb += q.btb ;
+			ec ++ ;
+
+			midsign = pnode->getSign( 7 - i ) ;
+			signs[i] = pnode->getSign( i ) ;
+		}
+	} // all QEFs summed 
+
+	m.count = ec ;
+	if ( ec == 0 ) // no QEFs found/summed above
+		return ;
+
+	pt[0] = pt[0] / ec; // average of summed points
+	pt[1] = pt[1] / ec;
+	pt[2] = pt[2] / ec;
+
+	unsigned char sg = 0 ;
+	for ( int i = 0 ; i < 8 ; i ++ ) {
+		if ( signs[i] == 1 )
+			sg |= ( 1 << i ) ;
+		else if ( signs[i] == -1 ) {  // Undetermined, use center sign instead
+			if ( midsign == 1 )
+				sg |= ( 1 << i ) ;
+			else if ( midsign == -1 )
+				printf("Wrong!");
+		}
+	}
+	m.signs = sg ;
+	m.height = ht + 1 ;
+
+	// Solve QEF for parent node
+	float mat[10];
+	BoundingBoxf box ;
+	box.begin.x = (float) st[0] ;
+	box.begin.y = (float) st[1] ;
+	box.begin.z = (float) st[2] ;
+	box.end.x = (float) st[0] + len ;
+	box.end.y = (float) st[1] + len ;
+	box.end.z = (float) st[2] + len ;
+	// pt is the average of child-nodes
+	// mp is the new solution point
+	float* mp = m.mp ;
+	mp[0] = mp[1] = mp[2] = 0 ;
+	m.error = calcPoint( ata, atb, btb, pt, mp, &box, mat, opts.qefSolver ) ;
+#ifdef CLAMP
+	if ( mp[0] < st[0] || mp[1] < st[1] || mp[2] < st[2] || // mp is outside boudning-box
+		mp[0] > st[0] + len || mp[1] > st[1] + len || mp[2] > st[2] + len ) {
+		mp[0] = pt[0] ;
+		mp[1] = pt[1] ;
+		mp[2] = pt[2] ;
+	}
+#endif
+}
+
+// a pseudo-leaf holding m, from the storage of worker
+PseudoLeafNode* Octree::makePseudoLeaf( MergedQEF& m, int worker ) {
+	unsigned int q = qefPool.store( qefCursor( worker ), m.q ) ;
+	return nodeArena( worker )->make<PseudoLeafNode>( m.height, m.signs, q, m.mp ) ;
+}
+
+
+
+// One bottom-up pass over the unsimplified tree: every internal node gets the
+// pseudo-leaf simplify() would collapse it into and the smallest threshold at
+// which it does. Leaves read with opts.lazyQEF are solved first, since any of
+// them may be left by a cut.
+void Octree::buildCollapseTree( ) {
+	if ( ! this->hasQEF ) {
+		printf("No QEF data, can not build the collapse-error tree.\n") ;
+		return ;
+	}
+	double start = Parallel::wallTime( ) ;
+	int st[3] = { 0, 0, 0 } ;
+	if ( opts.lazyQEF ) {
+		int count = 0 ;
+		reserveArenas( 1 ) ;
+		solveLazy( this->root, st, this->dimen, count ) ;
+		solvePending( 0 ) ;
+	}
+	collapseTree.clear( ) ;
+	cutNodes.clear( ) ;
+	fullRoot = this->root ;
+	float maxError = buildCollapseTree( this->root, st, this->dimen ) ;
+	printf("Built collapse-error tree of %d nodes in %f seconds, everything collapses at %g.\n", 
+		(int) collapseTree.size( ), Parallel::wallTime( ) - start, maxError ) ;
+}
+
+// returns the smallest threshold at which node is collapsed, 0 for leaves
+float Octree::buildCollapseTree( OctreeNode* node, int st[3], int len ) {
+	if ( node == NULL || node->getType() != INTERNAL )
+		return 0 ;
+
+	InternalNode* inode = (InternalNode*) node ;
+	OctreeNode* collapsed[8] ; // the children as seen by simplify() once they are collapsed
+	float maxError = 0 ;
+	int nlen = len / 2 ;
+	int nst[3] ;
+	for ( int i = 0 ; i < 8 ; i ++ ) {
+		nst[0] = st[0] + vertMap[i][0] * nlen ;
+		nst[1] = st[1] + vertMap[i][1] * nlen ;
+		nst[2] = st[2] + vertMap[i][2] * nlen ;
+		float e = buildCollapseTree( inode->child[i], nst, nlen ) ;
+		if ( e > maxError )
+			maxError = e ;
+		collapsed[i] = inode->child[i] ;
+		if ( collapsed[i] != NULL && collapsed[i]->getType() == INTERNAL )
+			collapsed[i] = collapseTree[ ((InternalNode*) collapsed[i])->collapse ].node ;
+	}
+
+	MergedQEF m ;
+	mergeChildren( collapsed, st, len, m ) ;
+	CollapseEntry e ;
+	if ( m.count == 0 ) { // simplify() drops nodes without children at any threshold
+		e.error = 0 ;
+		e.node = NULL ;
+	}
+	else {
+		e.error = m.error ;
+		if ( ! ( e.error <= HUGE_VALF ) ) // nan, never collapsed by simplify()
+			e.error = HUGE_VALF ;
+		e.node = makePseudoLeaf( m, 0 ) ;
+	}
+	if ( e.error > maxError )
+		maxError = e.error ;
+	e.maxError = maxError ;
+	e.count = m.count ;
+	e.children = 0 ;
+	e.parent = -1 ;
+	e.cut = 0 ;
+	inode->collapse = (int) collapseTree.size( ) ;
+	for ( int i = 0 ; i < 8 ; i ++ ) {
+		if ( inode->child[i] != NULL && inode->child[i]->getType() == INTERNAL ) {
+			collapseTree[ ((InternalNode*) inode->child[i])->collapse ].parent = inode->collapse ;
+			e.children ++ ;
+		}
+	}
+	collapseTree.push_back( e ) ;
+	return maxError ;
+}
+
+// Replace root by the tree simplify( thresh ) gives on the unsimplified tree,
+// without solving any QEFs.
+void Octree::cutCollapseTree( float thresh ) {
+	if ( fullRoot == NULL ) {
+		printf("No collapse-error tree, call buildCollapseTree() first.\n") ;
+		return ;
+	}
+	double start = Parallel::wallTime( ) ;
+	for ( size_t i = 0 ; i < collapseTree.size( ) ; i ++ )
+		collapseTree[i].cut = ( collapseTree[i].maxError <= thresh ) ;
+	replaceCut( ) ;
+
+	int nodecount[3] ;
+	countNodes( nodecount ) ;
+	printf("Cut at threshold %g in %f seconds: Internal %d\tPseudo %d\tLeaf %d\n", thresh, 
+		Parallel::wallTime( ) - start, nodecount[0], nodecount[1], nodecount[2] ) ;
+}
+
+// Collapse nodes in order of their QEF error until the output has at most
+// maxVertices vertices and about maxTriangles triangles.
+// A node is a candidate once all its internal children are collapsed. Every
+// leaf and pseudo-leaf is one vertex, and on a closed surface each vertex
+// less is two triangles less, so after one cellProcCount() of the full tree
+// the triangle count is kept up to date without contouring.
+void Octree::cutToBudget( int maxVertices, int maxTriangles ) {
+	if ( fullRoot == NULL ) {
+		printf("No collapse-error tree, call buildCollapseTree() first.\n") ;
+		return ;
+	}
+	double start = Parallel::wallTime( ) ;
+	int numVertices = 0, numTris = 0 ;
+	cellProcCount( fullRoot, numVertices, numTris ) ;
+
+	typedef std::pair<float, int> Candidate ; // error, entry
+	std::priority_queue< Candidate, std::vector<Candidate>, std::greater<Candidate> > heap ;
+	std::vector<int> left( collapseTree.size( ) ) ; // internal children not collapsed yet
+	for ( size_t i = 0 ; i < collapseTree.size( ) ; i ++ ) {
+		collapseTree[i].cut = 0 ;
+		left[i] = collapseTree[i].children ;
+		if ( left[i] == 0 )
+			heap.push( Candidate( collapseTree[i].error, (int) i ) ) ;
+	}
+
+	float lastError = 0 ;
+	int numCollapsed = 0 ;
+	while ( ! heap.empty( ) && ( numVertices > maxVertices || numTris > maxTriangles ) ) {
+		Candidate c = heap.top( ) ;
+		heap.pop( ) ;
+		CollapseEntry& e = collapseTree[ c.second ] ;
+		e.cut = 1 ;
+		int removed = e.count - ( e.node != NULL ? 1 : 0 ) ;
+		numVertices -= removed ;
+		numTris -= 2 * removed ;
+		lastError = c.first ;
+		numCollapsed ++ ;
+		if ( e.parent >= 0 && -- left[ e.parent ] == 0 )
+			heap.push( Candidate( collapseTree[ e.parent ].error, e.parent ) ) ;
+	}
+	replaceCut( ) ;
+
+	printf("Cut to budget in %f seconds: %d collapses up to error %g, %d vertices, about %d triangles\n", 
+		Parallel::wallTime( ) - start, numCollapsed, lastError, numVertices, numTris ) ;
+}
+
+// make root the cut of fullRoot given by CollapseEntry::cut.
+// The cut shares the leaves and the pseudo-leaves of the collapse-error tree,
+// only the internal nodes above it are new. Those of the previous cut are recycled.
+void Octree::replaceCut( ) {
+	for ( size_t i = 0 ; i < cutNodes.size( ) ; i ++ )
+		recycleNode( cutNodes[i] ) ;
+	cutNodes.clear( ) ;
+	this->root = cutCollapseTree( fullRoot ) ;
+}
+
+OctreeNode* Octree::cutCollapseTree( OctreeNode* node ) {
+	if ( node == NULL )
+		return NULL ;
+	if ( node->getType() != INTERNAL ) {
+		((QEFMixin*) node)->index = -1 ; // no vertex in this cut yet
+		return node ;
+	}
+
+	InternalNode* inode = (InternalNode*) node ;
+	CollapseEntry& e = collapseTree[ inode->collapse ] ;
+	if ( e.cut ) {
+		if ( e.node != NULL )
+			e.node->index = -1 ;
+		return e.node ;
+	}
+	InternalNode* cnode = nodeArena()->make<InternalNode>() ;
+	cutNodes.push_back( cnode ) ;
+	for ( int i = 0 ; i < 8 ; i ++ )
+		cnode->child[i] = cutCollapseTree( inode->child[i] ) ;
+	return cnode ;
+}
+
+void Octree::setDimen( int dimen ) {
+	this->dimen = dimen ;
+	this->maxDepth = 0 ;
+	int temp = 1 ;
+	while ( temp < this->dimen ) {
+		maxDepth ++ ;
+		temp <<= 1 ;
+	}
+	printf(" dimen: %d maxDepth: %d\n", this->dimen, maxDepth ) ;
+}
+
+void Octree::readDCF( char* fname ) {
+	double start = Parallel::wallTime( ) ;
+	if ( strstr( fname, ".dcf2" ) != NULL || strstr( fname, ".DCF2" ) != NULL ) {
+		readDCF2( fname ) ;
+	}
+	else if ( opts.loader == DCF_MMAP || opts.loader == DCF_PARALLEL ) {
+		readDCFMapped( fname ) ;
+	}
+	else {
+		FILE* fin = fopen( fname, "rb" ) ;
+		if ( fin == NULL )
+			printf("Can not open file %s.\n", fname) ;
+		
+		// Process header
+		char version[10] ;
+		fread( version, sizeof( char ), 10, fin ) ;
+		if ( strcmp( version, "multisign" ) != 0 ) {
+			printf("Wrong DCF version.\n") ;
+			exit(0) ;
+		}
+		
+		int dimen ;
+		fread( &dimen, sizeof( int ), 1, fin ) ;
+		fread( &dimen, sizeof( int ), 1, fin ) ;
+		fread( &dimen, sizeof( int ), 1, fin ) ;
+		setDimen( dimen ) ;
+
+		// Recursive reader
+		int st[3] = {0, 0, 0} ;
+		this->root = readDCF( fin, st, this->dimen, maxDepth ) ;
+		fclose( fin ) ;
+	}
+	// the leaves that did not fill a whole batch
+	int nworkers = (int) pending.size( ) ;
+	Parallel::parallelFor( nworkers, Parallel::numThreads( opts.numThreads ), [&]( int i, int worker ) {
+		solvePending( i ) ;
+	} ) ;
+	printf("Time used reading: %f seconds.\n", Parallel::wallTime( ) - start ) ;
+
+	int nodecount[3];
+	countNodes( nodecount );
+	std::cout << " Read nodes from file: Internal " << nodecount[0] << "\tPseudo " << nodecount[1] << "\tLeaf " << nodecount[2] << "\n";
+
+	// optional octree simplification
+	// the recursive readers collapse nodes as they go with opts.streamSimplify,
+	// only the nodes above the subtrees of the parallel and DCF2 readers are left
+	int streamed = streamThreshold > 0 && opts.loader != DCF_PARALLEL && 
+		strstr( fname, ".dcf2" ) == NULL && strstr( fname, ".DCF2" ) == NULL ;
+	if ( streamed ) {
+		std::cout << "Simplified while reading with threshold " << simplify_threshold << "\n";
+	}
+	else if (simplify_threshold > 0 ) {
+		std::cout << "Simplifying with threshold " << simplify_threshold << "\n";
+		int nodecount1[3],nodecount2[3];
+		countNodes( nodecount1 );
+		std::cout << " Before simplify: Internal " << nodecount1[0] << "\tPseudo " << nodecount1[1] << "\tLeaf " << nodecount1[2] << "\n";
+		simplify( simplify_threshold );
+		countNodes( nodecount2 );
+		std::cout << "  After simplify: Internal " << nodecount2[0] << "\tPseudo " << nodecount2[1] << "\tLeaf " << nodecount2[2] << "\n";
+		std::cout << "  Nodecount I+P+L reduced from " << nodecount1[0]+nodecount1[1]+nodecount1[2] << " to " << nodecount2[0]+nodecount2[1]+nodecount2[2] << "\n";
+	}
+	if ( opts.lazyQEF && this->hasQEF ) {
+		double lazyStart = Parallel::wallTime( ) ;
+		int st[3] = { 0, 0, 0 } ;
+		int count = 0 ;
+		reserveArenas( 1 ) ;
+		solveLazy( this->root, st, this->dimen, count ) ;
+		solvePending( 0 ) ;
+		printf("Solved %d leaf minimizers in %f seconds.\n", count, Parallel::wallTime( ) - lazyStart ) ;
+	}
+	printMemoryStats( ) ;
+	printf("Done reading.\n") ;	
+}
+
+// only InternalNode and LeafNode returned by this function
+// st cube corner (x,y,z)
+// len cube side length
+// ht node depth (root has 0, leaf has maxDepth)
+//
+// recursive reader
+OctreeNode* Octree::readDCF( FILE* fin, int st[3], int len, int height ) {
+	OctreeNode* rvalue = NULL ;
+
+	int type ;
+	fread( &type, sizeof( int ), 1, fin ) ;  // Get type
+	//printf("%d %d (%02d, %02d, %02d) NodeType: %d\n", height, len, st[0], st[1], st[2], type);
+
+	if ( type == 0 ) { // Internal node
+		rvalue = nodeArena()->make<InternalNode>() ;
+		int child_len = len / 2 ; // len of child node is half that of parent
+		int child_st[3] ;
+
+		for ( int i = 0 ; i < 8 ; i ++ ) {  // create eight child nodes
+			child_st[0] = st[0] + vertMap[i][0] * child_len; // child st position
+			child_st[1] = st[1] + vertMap[i][1] * child_len;
+			child_st[2] = st[2] + vertMap[i][2] * child_len;
+			((InternalNode *)rvalue)->child[i] = readDCF( fin, child_st, child_len, height - 1 ) ; // height is one less than parent
+		}
+		if ( streamThreshold > 0 ) // all children are read, try the collapse now
+			return collapseNode( (InternalNode*) rvalue, st, len, streamThreshold, 0 ) ;
+		return rvalue ;
+	}
+	
+	else if ( type == 1 ) { // Empty node, 
+		short sg ;
+		fread( &sg, sizeof( short ), 1, fin ) ; // signs not used??
+		assert( rvalue == NULL );
+		return rvalue ;
+	}
+	
+	else if ( type == 2 ) { // Leaf node
+		short rsg[8] ;
+		fread( rsg, sizeof( short ), 8, fin ) ;
+		unsigned char sg = 0 ;
+		for ( int i = 0 ; i < 8 ; i ++ ) { // set signs
+			if ( rsg[i] != 0 )
+				sg |= ( 1 << i ) ;
+		}
+
+		// intersections and normals
+		float inters[12][3], norms[12][3] ;
+		int numinters = 0;
+		for ( int i = 0 ; i < 12 ; i ++ ) { // potentially there are 12 intersections, one for each edge of the cube
+			int num = 0;
+			fread( &num, sizeof( int ), 1, fin ) ;
+			//if ( num > 0 ) {
+				for ( int j = 0 ; j < num ; j ++ ) {
+					float off ;
+					fread( &off, sizeof( float ), 1, fin ) ;
+					fread( norms[numinters], sizeof( float ), 3, fin ) ; // normals
+					
+					int dir = i / 4 ;
+					int base = edgevmap[ i ][ 0 ] ;
+					inters[numinters][0] = st[0] + vertMap[base][0] * len ;
+					inters[numinters][1] = st[1] + vertMap[base][1] * len ;
+					inters[numinters][2] = st[2] + vertMap[base][2] * len ;
+					inters[numinters][dir] += off ;
+					numinters ++ ;
+				}
+			//}
+		}
+		
+		if ( numinters > 0 )
+			rvalue = makeLeaf( 0, height, sg, st, len, numinters, inters, norms ) ;
+		else
+			rvalue = NULL ;
+		
+		return rvalue ;
+	}
+	else {
+		printf("Wrong! Node Type: %d\n", type);
+		exit(-1);
+	}
+}
+
+// a new leaf and its QEF, from the storage of worker.
+// With opts.lazyQEF the leaf keeps the mass point until solveLazy(),
+// with opts.batchQEF the minimizer is left to solvePending( worker ).
+OctreeNode* Octree::makeLeaf( int worker, int ht, unsigned char sg, int st[3], int len, int numint, float inters[12][3], float norms[12][3] ) {
+	QEFData q ;
+	LeafNode* lnode ;
+	if ( opts.lazyQEF ) {
+		float pt[3] ;
+		LeafNode::accumulateQEF( numint, inters, norms, q, pt ) ;
+		lnode = nodeArena( worker )->make<LeafNode>( ht, sg, pt ) ;
+		lnode->solved = 0 ;
+	}
+	else if ( opts.batchQEF && opts.qefSolver == QEF_PSEUDO_INVERSE ) {
+		float pt[3] ;
+		LeafNode::accumulateQEF( numint, inters, norms, q, pt ) ;
+		lnode = nodeArena( worker )->make<LeafNode>( ht, sg, pt ) ;
+		addPending( worker, lnode, q, pt, st, len ) ;
+	}
+	else {
+		lnode = nodeArena( worker )->make<LeafNode>( ht, sg, st, len, numint, inters, norms, q, opts.qefSolver ) ;
+	}
+	lnode->qef = qefPool.store( qefCursor( worker ), q ) ;
+	return lnode ;
+}
+
+// queue lnode for the batch of worker, the batch is solved once it is full
+void Octree::addPending( int worker, LeafNode* lnode, QEFData& q, float pt[3], int st[3], int len ) {
+	PendingLeaves& p = pending[ worker ] ;
+	p.qefs.add( q.ata, q.atb, q.btb, pt ) ;
+	p.leaves.push_back( lnode ) ;
+	for ( int i = 0 ; i < 3 ; i ++ )
+		p.cells.push_back( st[i] ) ;
+	p.cells.push_back( len ) ;
+	lnode->solved = 0 ;
+	if ( (int) p.leaves.size( ) >= PendingLeaves::BATCH_SIZE )
+		solvePending( worker ) ;
+}
+
+// place the minimizers of the pending leaves of worker
+void Octree::solvePending( int worker ) {
+	PendingLeaves& p = pending[ worker ] ;
+	p.qefs.solve( ) ;
+	for ( size_t i = 0 ; i < p.leaves.size( ) ; i ++ ) {
+		LeafNode* lnode = p.leaves[i] ;
+		for ( int j = 0 ; j < 3 ; j ++ )
+			lnode->mp[j] = p.qefs.rvalue[j][i] ;
+#ifdef CLAMP
+		float pt[3] = { p.qefs.midpoint[0][i], p.qefs.midpoint[1][i], p.qefs.midpoint[2][i] } ;
+		lnode->clampToCell( &(p.cells[ 4 * i ]), p.cells[ 4 * i + 3 ], pt ) ;
+#endif
+		lnode->solved = 1 ;
+	}
+	p.qefs.clear( ) ;
+	p.leaves.clear( ) ;
+	p.cells.clear( ) ;
+}
+
+// place the minimizers of the leaves that opts.lazyQEF left at their mass point,
+// count is increased by the number of leaves solved
+void Octree::solveLazy( OctreeNode* node, int st[3], int len, int& count ) {
+	if ( node == NULL )
+		return ;
+	if ( node->getType() == INTERNAL ) {
+		InternalNode* inode = (InternalNode*) node ;
+		int nlen = len / 2 ;
+		int nst[3] ;
+		for ( int i = 0 ; i < 8 ; i ++ ) {
+			nst[0] = st[0] + vertMap[i][0] * nlen ;
+			nst[1] = st[1] + vertMap[i][1] * nlen ;
+			nst[2] = st[2] + vertMap[i][2] * nlen ;
+			solveLazy( inode->child[i], nst, nlen, count ) ;
+		}
+		return ;
+	}
+	if ( node->getType() != LEAF || ((LeafNode*) node)->solved )
+		return ; // pseudo-leaves are solved by simplify()
+
+	LeafNode* lnode = (LeafNode*) node ;
+	QEFData q = qefPool.get( lnode->qef ) ;
+	float pt[3] = { lnode->mp[0], lnode->mp[1], lnode->mp[2] } ;
+	if ( opts.batchQEF && opts.qefSolver == QEF_PSEUDO_INVERSE )
+		addPending( 0, lnode, q, pt, st, len ) ;
+	else
+		lnode->solve( st, len, q, pt, opts.qefSolver ) ;
+	count ++ ;
+}
+
+// fixed-size fields of the DCF stream, read straight out of the mapping.
+// memcpy() is only there because the fields are not aligned, it compiles to a plain load.
+static inline int dcfInt( const char*& cur ) {
+	int v ;
+	memcpy( &v, cur, sizeof( int ) ) ;
+	cur += sizeof( int ) ;
+	return v ;
+}
+
+static inline float dcfFloat( const char*& cur ) {
+	float v ;
+	memcpy( &v, cur, sizeof( float ) ) ;
+	cur += sizeof( float ) ;
+	return v ;
+}
+
+static inline short dcfShort( const char*& cur ) {
+	short v ;
+	memcpy( &v, cur, sizeof( short ) ) ;
+	cur += sizeof( short ) ;
+	return v ;
+}
+
+static void dcfCorrupt( ) {
+	printf("Truncated or corrupt DCF file.\n") ;
+	exit(-1) ;
+}
+
+// same as readDCF( char* ) with DCF_FREAD, but the file is mapped 
+// and walked by readDCF( const char*&, ... ) without any per-field reads
+void Octree::readDCFMapped( char* fname ) {
+	MappedFile file ;
+	if ( ! file.open( fname ) ) {
+		printf("Can not open file %s.\n", fname) ;
+		exit(0) ;
+	}
+	const char* cur = file.data ;
+	const char* end = file.data + file.size ;
+
+	// Process header
+	if ( file.size < 10 + 3 * sizeof( int ) || strncmp( cur, "multisign", 10 ) != 0 ) {
+		printf("Wrong DCF version.\n") ;
+		exit(0) ;
+	}
+	cur += 10 ;
+	dcfInt( cur ) ;
+	dcfInt( cur ) ;
+	setDimen( dcfInt( cur ) ) ;
+
+	int st[3] = {0, 0, 0} ;
+	if ( opts.loader != DCF_PARALLEL ) {
+		// Recursive reader
+		this->root = readDCF( cur, end, st, this->dimen, maxDepth, 0 ) ;
+		return ;
+	}
+
+	// Build the nodes above splitDepth and find where each subtree below starts
+	std::vector<DCFSubtree> tasks ;
+	this->root = NULL ;
+	scanDCF( cur, end, st, this->dimen, maxDepth, 0, &(this->root), tasks ) ;
+
+	// Decode the subtrees, each one is an independent preorder stream
+	int nthreads = Parallel::numThreads( opts.numThreads ) ;
+	reserveArenas( nthreads ) ;
+	printf(" Decoding %d subtrees at depth %d on %d threads\n", (int) tasks.size(), opts.splitDepth, nthreads ) ;
+	Parallel::parallelFor( (int) tasks.size(), nthreads, [&]( int i, int worker ) {
+		DCFSubtree& t = tasks[i] ;
+		const char* c = t.data ;
+		*(t.slot) = readDCF( c, end, t.st, t.len, t.ht, worker ) ;
+	} ) ;
+}
+
+// skip over one node and all its children, only the type and count fields are read
+static const char* skipDCF( const char* cur, const char* end ) {
+	int pending = 1 ; // nodes still to skip
+	while ( pending > 0 ) {
+		if ( end - cur < (long) sizeof( int ) )
+			dcfCorrupt( ) ;
+		int type = dcfInt( cur ) ;
+		pending -- ;
+		if ( type == 0 ) {
+			pending += 8 ;
+		}
+		else if ( type == 1 ) {
+			cur += sizeof( short ) ;
+		}
+		else if ( type == 2 ) {
+			cur += 8 * sizeof( short ) ;
+			for ( int i = 0 ; i < 12 ; i ++ ) {
+				if ( end - cur < (long) sizeof( int ) )
+					dcfCorrupt( ) ;
+				int num = dcfInt( cur ) ;
+				if ( num < 0 || num > 12 )
+					dcfCorrupt( ) ;
+				cur += num * 4 * sizeof( float ) ; // offset and normal
+			}
+		}
+		else {
+			printf("Wrong! Node Type: %d\n", type);
+			exit(-1);
+		}
+	}
+	if ( cur > end )
+		dcfCorrupt( ) ;
+	return cur ;
+}
+
+// create the internal nodes above opts.splitDepth and record every subtree 
+// at opts.splitDepth as a task for readDCF( const char*&, ... ).
+// slot is where the node is attached in its parent.
+void Octree::scanDCF( const char*& cur, const char* end, int st[3], int len, int height, int depth, OctreeNode** slot, std::vector<DCFSubtree>& tasks ) {
+	if ( end - cur < (long) sizeof( int ) )
+		dcfCorrupt( ) ;
+	int type ;
+	memcpy( &type, cur, sizeof( int ) ) ; // peek, the decoder reads the type again
+
+	if ( depth >= opts.splitDepth && type == 0 ) {
+		DCFSubtree t ;
+		t.data = cur ;
+		for ( int i = 0 ; i < 3 ; i ++ )
+			t.st[i] = st[i] ;
+		t.len = len ;
+		t.ht = height ;
+		t.slot = slot ;
+		tasks.push_back( t ) ;
+		cur = skipDCF( cur, end ) ;
+	}
+	else if ( type == 0 ) {
+		cur += sizeof( int ) ;
+		InternalNode* inode = nodeArena()->make<InternalNode>() ;
+		*slot = inode ;
+		int child_len = len / 2 ;
+		int child_st[3] ;
+		for ( int i = 0 ; i < 8 ; i ++ ) {
+			child_st[0] = st[0] + vertMap[i][0] * child_len;
+			child_st[1] = st[1] + vertMap[i][1] * child_len;
+			child_st[2] = st[2] + vertMap[i][2] * child_len;
+			scanDCF( cur, end, child_st, child_len, height - 1, depth + 1, &(inode->child[i]), tasks ) ;
+		}
+	}
+	else { // empty or leaf nodes above splitDepth are cheap, decode them right away
+		*slot = readDCF( cur, end, st, len, height, 0 ) ;
+	}
+}
+
+// recursive reader working on a mapped DCF file
+// cur is advanced past the node (and all its children)
+// builds exactly the same nodes as readDCF( FILE*, ... )
+// nodes and QEFs are stored through the arena and cursor of worker
+OctreeNode* Octree::readDCF( const char*& cur, const char* end, int st[3], int len, int height, int worker ) {
+	if ( end - cur < (long) sizeof( int ) )
+		dcfCorrupt( ) ;
+	int type = dcfInt( cur ) ; // Get type
+
+	if ( type == 0 ) { // Internal node
+		InternalNode* inode = nodeArena( worker )->make<InternalNode>() ;
+		int child_len = len / 2 ;
+		int child_st[3] ;
+
+		for ( int i = 0 ; i < 8 ; i ++ ) {
+			child_st[0] = st[0] + vertMap[i][0] * child_len;
+			child_st[1] = st[1] + vertMap[i][1] * child_len;
+			child_st[2] = st[2] + vertMap[i][2] * child_len;
+			inode->child[i] = readDCF( cur, end, child_st, child_len, height - 1, worker ) ;
+		}
+		if ( streamThreshold > 0 ) // all children are read, try the collapse now
+			return collapseNode( inode, st, len, streamThreshold, worker ) ;
+		return inode ;
+	}
+	else if ( type == 1 ) { // Empty node, sign not used
+		if ( end - cur < (long) sizeof( short ) )
+			dcfCorrupt( ) ;
+		cur += sizeof( short ) ;
+		return NULL ;
+	}
+	else if ( type == 2 ) { // Leaf node
+		if ( end - cur < (long) ( 8 * sizeof( short ) ) )
+			dcfCorrupt( ) ;
+		unsigned char sg = 0 ;
+		for ( int i = 0 ; i < 8 ; i ++ ) {
+			if ( dcfShort( cur ) != 0 )
+				sg |= ( 1 << i ) ;
+		}
+
+		float inters[12][3], norms[12][3] ;
+		int numinters = 0;
+		for ( int i = 0 ; i < 12 ; i ++ ) {
+			if ( end - cur < (long) sizeof( int ) )
+				dcfCorrupt( ) ;
+			int num = dcfInt( cur ) ;
+			if ( num < 0 || num > 12 - numinters || end - cur < (long) ( num * 4 * sizeof( float ) ) )
+				dcfCorrupt( ) ;
+			for ( int j = 0 ; j < num ; j ++ ) {
+				float off = dcfFloat( cur ) ;
+				norms[numinters][0] = dcfFloat( cur ) ;
+				norms[numinters][1] = dcfFloat( cur ) ;
+				norms[numinters][2] = dcfFloat( cur ) ;
+
+				int dir = i / 4 ;
+				int base = edgevmap[ i ][ 0 ] ;
+				inters[numinters][0] = st[0] + vertMap[base][0] * len ;
+				inters[numinters][1] = st[1] + vertMap[base][1] * len ;
+				inters[numinters][2] = st[2] + vertMap[base][2] * len ;
+				inters[numinters][dir] += off ;
+				numinters ++ ;
+			}
+		}
+
+		if ( numinters > 0 )
+			return makeLeaf( worker, height, sg, st, len, numinters, inters, norms ) ;
+		else
+			return NULL ;
+	}
+	else {
+		printf("Wrong! Node Type: %d\n", type);
+		exit(-1);
+	}
+}
+
+/************************************************************************/
+/* Indexed DCF2 files                                                   */
+/************************************************************************/
+
+// walk one node of a DCF stream and its children, adding a table entry 
+// for every node with depth <= indexDepth. Entry offsets are relative to body.
+// nodes, leaves, bmin and bmax accumulate the statistics of the parent.
+static void scanDCF2( const char*& cur, const char* end, const char* body, int st[3], int len, int depth, int indexDepth,
+	std::vector<DCF2Entry>& table, int& nodes, int& leaves, int bmin[3], int bmax[3] )
+{
+	int entry = -1 ;
+	if ( depth <= indexDepth ) {
+		DCF2Entry e ;
+		memset( &e, 0, sizeof( DCF2Entry ) ) ;
+		e.offset = cur - body ;
+		for ( int i = 0 ; i < 3 ; i ++ )
+			e.st[i] = st[i] ;
+		e.len = len ;
+		e.depth = depth ;
+		entry = (int) table.size( ) ;
+		table.push_back( e ) ;
+	}
+
+	// statistics of this subtree
+	int snodes = 0, sleaves = 0 ;
+	int smin[3] = { st[0] + len, st[1] + len, st[2] + len } ;
+	int smax[3] = { st[0], st[1], st[2] } ;
+
+	if ( end - cur < (long) sizeof( int ) )
+		dcfCorrupt( ) ;
+	int type = dcfInt( cur ) ;
+	if ( type == 0 ) {
+		snodes ++ ;
+		int child_len = len / 2 ;
+		int child_st[3] ;
+		for ( int i = 0 ; i < 8 ; i ++ ) {
+			child_st[0] = st[0] + vertMap[i][0] * child_len;
+			child_st[1] = st[1] + vertMap[i][1] * child_len;
+			child_st[2] = st[2] + vertMap[i][2] * child_len;
+			scanDCF2( cur, end, body, child_st, child_len, depth + 1, indexDepth, table, snodes, sleaves, smin, smax ) ;
+		}
+	}
+	else if ( type == 1 ) {
+		cur += sizeof( short ) ;
+	}
+	else if ( type == 2 ) {
+		cur += 8 * sizeof( short ) ;
+		int numinters = 0 ;
+		for ( int i = 0 ; i < 12 ; i ++ ) {
+			if ( end - cur < (long) sizeof( int ) )
+				dcfCorrupt( ) ;
+			int num = dcfInt( cur ) ;
+			if ( num < 0 || num > 12 )
+				dcfCorrupt( ) ;
+			cur += num * 4 * sizeof( float ) ;
+			numinters += num ;
+		}
+		if ( numinters > 0 ) { // leaves without intersections are dropped by the reader
+			snodes ++ ;
+			sleaves ++ ;
+			for ( int i = 0 ; i < 3 ; i ++ ) {
+				smin[i] = st[i] ;
+				smax[i] = st[i] + len ;
+			}
+		}
+	}
+	else {
+		printf("Wrong! Node Type: %d\n", type);
+		exit(-1);
+	}
+	if ( cur > end )
+		dcfCorrupt( ) ;
+
+	if ( entry >= 0 ) {
+		DCF2Entry& e = table[ entry ] ;
+		e.type = type ;
+		e.nodeCount = snodes ;
+		e.leafCount = sleaves ;
+		for ( int i = 0 ; i < 3 ; i ++ ) {
+			e.bmin[i] = smin[i] ;
+			e.bmax[i] = smax[i] ;
+		}
+	}
+	nodes += snodes ;
+	leaves += sleaves ;
+	if ( sleaves > 0 ) {
+		for ( int i = 0 ; i < 3 ; i ++ ) {
+			if ( smin[i] < bmin[i] ) bmin[i] = smin[i] ;
+			if ( smax[i] > bmax[i] ) bmax[i] = smax[i] ;
+		}
+	}
+}
+
+static const char dcf2Magic[10] = "dcf2index" ;
+
+// size of the DCF2 header and table in bytes
+static long long dcf2HeaderSize( int numEntries ) {
+	return 10 + 3 * sizeof( int ) + (long long) numEntries * sizeof( DCF2Entry ) ;
+}
+
+// write a copy of a DCF file with an index table of all nodes down to indexDepth
+void Octree::convertDCF2( char* dcfname, char* outname, int indexDepth ) {
+	MappedFile file ;
+	if ( ! file.open( dcfname ) ) {
+		printf("Can not open file %s.\n", dcfname) ;
+		exit(0) ;
+	}
+	const char* cur = file.data ;
+	const char* end = file.data + file.size ;
+	if ( file.size < 10 + 3 * sizeof( int ) || strncmp( cur, "multisign", 10 ) != 0 ) {
+		printf("Wrong DCF version.\n") ;
+		exit(0) ;
+	}
+	cur += 10 ;
+	dcfInt( cur ) ;
+	dcfInt( cur ) ;
+	int dimen = dcfInt( cur ) ;
+	const char* body = cur ;
+
+	// one pass over the stream collects the table
+	std::vector<DCF2Entry> table ;
+	int st[3] = {0, 0, 0} ;
+	int nodes = 0, leaves = 0 ;
+	int bmin[3] = { dimen, dimen, dimen }, bmax[3] = { 0, 0, 0 } ;
+	scanDCF2( cur, end, body, st, dimen, 0, indexDepth, table, nodes, leaves, bmin, bmax ) ;
+
+	int numEntries = (int) table.size( ) ;
+	long long base = dcf2HeaderSize( numEntries ) ;
+	for ( int i = 0 ; i < numEntries ; i ++ )
+		table[i].offset += base ;
+
+	FILE* fout = fopen( outname, "wb" ) ;
+	if ( fout == NULL ) {
+		printf("Can not open file %s.\n", outname) ;
+		exit(0) ;
+	}
+	fwrite( dcf2Magic, sizeof( char ), 10, fout ) ;
+	fwrite( &dimen, sizeof( int ), 1, fout ) ;
+	fwrite( &indexDepth, sizeof( int ), 1, fout ) ;
+	fwrite( &numEntries, sizeof( int ), 1, fout ) ;
+	fwrite( &(table[0]), sizeof( DCF2Entry ), numEntries, fout ) ;
+	fwrite( body, sizeof( char ), cur - body, fout ) ;
+	fclose( fout ) ;
+
+	printf("Wrote %s: %d table entries down to depth %d, %d nodes, %d leaves.\n", outname, numEntries, indexDepth, nodes, leaves ) ;
+}
+
+// read the header and index table of a DCF2 file, returns 0 if it is not one
+int Octree::readDCF2Table( char* fname, int& dimen, int& indexDepth, std::vector<DCF2Entry>& table ) {
+	FILE* fin = fopen( fname, "rb" ) ;
+	if ( fin == NULL )
+		return 0 ;
+	char magic[10] ;
+	int numEntries = 0 ;
+	if ( fread( magic, sizeof( char ), 10, fin ) != 10 || strncmp( magic, dcf2Magic, 10 ) != 0 ||
+		 fread( &dimen, sizeof( int ), 1, fin ) != 1 ||
+		 fread( &indexDepth, sizeof( int ), 1, fin ) != 1 ||
+		 fread( &numEntries, sizeof( int ), 1, fin ) != 1 || numEntries <= 0 ) {
+		fclose( fin ) ;
+		return 0 ;
+	}
+	table.resize( numEntries ) ;
+	int ok = ( fread( &(table[0]), sizeof( DCF2Entry ), numEntries, fin ) == (size_t) numEntries ) ;
+	fclose( fin ) ;
+	return ok ;
+}
+
+// recreate the nodes of the index table in preorder. 
+// Subtrees at the bottom of the table are decoded if selected, and left empty otherwise.
+void Octree::buildDCF2( const std::vector<DCF2Entry>& table, int& next, int indexDepth, const std::vector<char>& selected, 
+	const char* data, const char* end, OctreeNode** slot, std::vector<DCFSubtree>& tasks )
+{
+	if ( next >= (int) table.size( ) )
+		dcfCorrupt( ) ;
+	int i = next ++ ;
+	const DCF2Entry& e = table[i] ;
+	int height = maxDepth - e.depth ;
+
+	if ( e.type == 0 && e.depth < indexDepth ) {
+		InternalNode* inode = nodeArena()->make<InternalNode>() ;
+		*slot = inode ;
+		for ( int c = 0 ; c < 8 ; c ++ )
+			buildDCF2( table, next, indexDepth, selected, data, end, &(inode->child[c]), tasks ) ;
+	}
+	else if ( ! selected[i] || e.type == 1 ) {
+		*slot = NULL ;
+	}
+	else if ( e.offset < 0 || e.offset >= end - data ) {
+		dcfCorrupt( ) ;
+	}
+	else if ( e.type == 0 ) {
+		DCFSubtree t ;
+		t.data = data + e.offset ;
+		for ( int k = 0 ; k < 3 ; k ++ )
+			t.st[k] = e.st[k] ;
+		t.len = e.len ;
+		t.ht = height ;
+		t.slot = slot ;
+		tasks.push_back( t ) ;
+	}
+	else {
+		const char* cur = data + e.offset ;
+		int st[3] = { e.st[0], e.st[1], e.st[2] } ;
+		*slot = readDCF( cur, end, st, e.len, height, 0 ) ;
+	}
+}
+
+void Octree::readDCF2( char* fname ) {
+	int dimen, indexDepth ;
+	std::vector<DCF2Entry> table ;
+	if ( ! readDCF2Table( fname, dimen, indexDepth, table ) ) {
+		printf("Wrong DCF2 file.\n") ;
+		exit(0) ;
+	}
+	setDimen( dimen ) ;
+
+	MappedFile file ;
+	if ( ! file.open( fname ) ) {
+		printf("Can not open file %s.\n", fname) ;
+		exit(0) ;
+	}
+
+	// Selection: requested entries take everything below them along
+	int n = (int) table.size( ) ;
+	std::vector<char> selected( n, 0 ) ;
+	if ( opts.subtrees.empty( ) && ! opts.hasRegion ) {
+		selected.assign( n, 1 ) ;
+	}
+	else {
+		for ( size_t k = 0 ; k < opts.subtrees.size( ) ; k ++ ) {
+			int i = opts.subtrees[k] ;
+			if ( i < 0 || i >= n )
+				continue ;
+			// the subtree of entry i is the run of entries after it that are deeper
+			selected[i] = 1 ;
+			for ( int j = i + 1 ; j < n && table[j].depth > table[i].depth ; j ++ )
+				selected[j] = 1 ;
+		}
+		if ( opts.hasRegion ) {
+			for ( int i = 0 ; i < n ; i ++ ) {
+				const DCF2Entry& e = table[i] ;
+				if ( e.leafCount > 0 &&
+					 e.bmin[0] <= opts.region[3] && e.bmax[0] >= opts.region[0] &&
+					 e.bmin[1] <= opts.region[4] && e.bmax[1] >= opts.region[1] &&
+					 e.bmin[2] <= opts.region[5] && e.bmax[2] >= opts.region[2] )
+					selected[i] = 1 ;
+			}
+		}
+	}
+
+	std::vector<DCFSubtree> tasks ;
+	int next = 0 ;
+	this->root = NULL ;
+	buildDCF2( table, next, indexDepth, selected, file.data, file.data + file.size, &(this->root), tasks ) ;
+
+	int nthreads = Parallel::numThreads( opts.numThreads ) ;
+	reserveArenas( nthreads ) ;
+	printf(" Decoding %d subtrees from a table of %d entries on %d threads\n", (int) tasks.size(), n, nthreads ) ;
+	const char* end = file.data + file.size ;
+	Parallel::parallelFor( (int) tasks.size(), nthreads, [&]( int i, int worker ) {
+		DCFSubtree& t = tasks[i] ;
+		const char* c = t.data ;
+		*(t.slot) = readDCF( c, end, t.st, t.len, t.ht, worker ) ;
+	} ) ;
+}
+
+// no-intersections algorithm
+// fname is the PLY output file
+void Octree::genContourNoInter2( char* fname ) {
+	Mesh mesh ;
+	genMeshNoInter2( mesh ) ;
+	mesh.writePLY( fname, ! opts.littleEndianPLY ) ;
+}
+
+// no-intersections algorithm, the surface goes into mesh.
+// The traversal is split into jobs at opts.contourDepth that run on several
+// threads and only share the face vertex table. Every leaf gets a number up
+// front. Each job lists the vertices it meets, its triangles and face vertex
+// moves, and merging the jobs in order numbers the vertices as the serial
+// traversal does, so the mesh does not depend on the number of threads.
+void Octree::genMeshNoInter2( Mesh& mesh ) {
+	releaseQEF( ) ; // minimizers are placed, contouring does not need the QEFs
+	mesh.clear( ) ;
+
+	NoInterShared shared ;
+	std::vector<float> leafPos ;
+	int numLeaves = 0 ;
+	generateVertexIndex( root, numLeaves, leafPos ) ; // node->index is the leaf number
+	std::vector< std::atomic<int> >( numLeaves ).swap( shared.leafJob ) ;
+	for ( int i = 0 ; i < numLeaves ; i ++ )
+		shared.leafJob[i].store( -1, std::memory_order_relaxed ) ;
+
+	int st[3] = {0,0,0};
+	printf("Processing contour...\n") ;
+
+	clock_t start = clock( ) ;
+	std::vector<ContourJob> plan ;
+	NoInterJob planner ;
+	planner.plan = &plan ;
+	cellProcContourNoInter2( root, st, dimen, 0, shared, planner ) ;
+
+	int nthreads = Parallel::numThreads( opts.numThreads ) ;
+	printf(" Contouring %d jobs at depth %d on %d threads\n", (int) plan.size( ), opts.contourDepth, nthreads ) ;
+	std::vector<NoInterJob> jobs( plan.size( ) ) ;
+	Parallel::parallelFor( (int) plan.size( ), nthreads, [&]( int i, int worker ) {
+		ContourJob& p = plan[i] ;
+		jobs[i].id = i ;
+		if ( p.kind == ContourJob::CELL )
+			cellProcContourNoInter2( p.node[0], p.st, p.len, 0, shared, jobs[i] ) ;
+		else if ( p.kind == ContourJob::FACE )
+			faceProcContourNoInter2( p.node, p.st, p.len, p.dir, 0, shared, jobs[i] ) ;
+		else
+			edgeProcContourNoInter2( p.node, p.st, p.len, p.dir, 0, shared, jobs[i] ) ;
+	} ) ;
+
+	// merge: a vertex is numbered where it is first met
+	std::vector<int> leafVert( numLeaves, -1 ), faceVert( shared.faces.slots( ), -1 ), edgeVert ;
+	std::vector<char> facePlaced( faceVert.size( ), 0 ) ;
+	founds = news = edgeVerts = 0 ;
+	for ( size_t j = 0 ; j < jobs.size( ) ; j ++ ) {
+		NoInterJob& job = jobs[j] ;
+		edgeVert.resize( job.edgePos.size( ) / 3 ) ;
+		for ( size_t k = 0 ; k < job.events.size( ) ; k ++ ) {
+			unsigned int kind = job.events[k] & NoInterJob::KIND ;
+			unsigned int id = job.events[k] & ~NoInterJob::KIND ;
+			const float zero[3] = { 0, 0, 0 } ;
+			if ( kind == NoInterJob::LEAF && leafVert[id] < 0 ) {
+				leafVert[id] = mesh.numVertices( ) ;
+				mesh.vertices.insert( mesh.vertices.end( ), &leafPos[ 3 * id ], &leafPos[ 3 * id ] + 3 ) ;
+				mesh.cells.push_back( id ) ;
+			}
+			else if ( kind == NoInterJob::FACE && faceVert[id] < 0 ) {
+				faceVert[id] = mesh.numVertices( ) ; // placed by the first move
+				mesh.vertices.insert( mesh.vertices.end( ), zero, zero + 3 ) ;
+				mesh.cells.push_back( -1 ) ;
+			}
+			else if ( kind == NoInterJob::EDGE ) {
+				edgeVert[id] = mesh.numVertices( ) ;
+				mesh.vertices.insert( mesh.vertices.end( ), &job.edgePos[ 3 * id ], &job.edgePos[ 3 * id ] + 3 ) ;
+				mesh.cells.push_back( -1 ) ;
+			}
+		}
+		for ( size_t k = 0 ; k < job.tris.size( ) ; k ++ ) {
+			unsigned int kind = job.tris[k] & NoInterJob::KIND ;
+			unsigned int id = job.tris[k] & ~NoInterJob::KIND ;
+			if ( kind == NoInterJob::LEAF )
+				mesh.triangles.push_back( leafVert[id] ) ;
+			else if ( kind == NoInterJob::FACE )
+				mesh.triangles.push_back( faceVert[id] ) ;
+			else
+				mesh.triangles.push_back( edgeVert[id] ) ;
+		}
+		for ( size_t k = 0 ; k < job.faceMoves.size( ) ; k ++ ) {
+			unsigned int id = job.faceMoves[k] & ~NoInterJob::KIND ;
+			float* nv = &mesh.vertices[ 3 * (size_t) faceVert[id] ] ;
+			float* cent = &job.faceCents[ 3 * k ] ;
+			for ( int c = 0 ; c < 3 ; c ++ )
+				nv[c] = facePlaced[id] ? ( nv[c] + cent[c] ) / 2 : cent[c] ;
+			facePlaced[id] = 1 ;
+		}
+		founds += job.founds ;
+		news += job.news ;
+		edgeVerts += job.edgeVerts ;
+		job = NoInterJob( ) ; // frees its arrays
+	}
+	faceVerts = news ;
+	clock_t finish = clock( ) ;
+	printf("Time used: %f seconds.\n", (float) (finish - start) / (float) CLOCKS_PER_SEC ) ;
+	
+	printf("Face vertices: %d Edge vertices: %d\n", faceVerts, edgeVerts ) ;
+	printf("New hash entries: %d. Found times: %d\n", news, founds) ;
+	printf("Vertices counted: %d Triangles counted: %d \n", mesh.numVertices( ), mesh.numTriangles( ) ) ;
+}
+
+
+// original algorithm
+// may produce intersecting polygons?
+void Octree::genContour( char* fname ) {
+	Mesh mesh ;
+	genMesh( mesh ) ;
+	mesh.writePLY( fname, ! opts.littleEndianPLY ) ;
+	printf("Actual triangles written: %d\n", actualTris ) ;
+}
+
+// original algorithm, the surface goes into mesh
+void Octree::genMesh( Mesh& mesh ) {
+	releaseQEF( ) ; // minimizers are placed, contouring does not need the QEFs
+	int numTris = 0 ;
+	int numVertices = 0 ;
+
+	mesh.clear( ) ;
+	clock_t start = clock();
+	if ( ! opts.singlePass ) {
+		cellProcCount ( root, numVertices, numTris ) ;
+		printf("numVertices: %d numTriangles: %d \n", numVertices, numTris ) ;
+		mesh.vertices.reserve( 3 * (size_t) numVertices ) ;
+		mesh.triangles.reserve( 3 * (size_t) numTris ) ;
+	}
+	int offset = 0; // start of vertex index
+
+	generateVertexIndex( root, offset, mesh.vertices );  // place vertices, populate node->index
+	printf("Placed %d vertices\n", offset ) ;
+	mesh.cells.resize( offset ) ; // vertex i is leaf i
+	for ( int i = 0 ; i < offset ; i ++ )
+		mesh.cells[i] = i ;
+
+	int nthreads = Parallel::numThreads( opts.numThreads ) ;
+	if ( nthreads > 1 && opts.contourDepth > 0 )
+		contourParallel( mesh.triangles, nthreads ) ;
+	else
+		cellProcContour( this->root, mesh.triangles ) ; // a single call to root runs algorithm on entire tree
+	actualTris = mesh.numTriangles( ) ;
+	clock_t finish = clock();
+	printf("Time used: %f seconds.\n", (float) (finish - start) / (float) CLOCKS_PER_SEC ) ;
+}
+
+// this collects the octree vertices in verts, 3 floats each
+// each vertex gets an index, which is stored in node->index
+void Octree::generateVertexIndex( OctreeNode* node, int& offset, std::vector<float>& verts ) {
+	NodeType type = node->getType() ;
+
+	if ( type == INTERNAL ) { // Internal node, recurse into tree
+		InternalNode* inode = ( (InternalNode* ) node ) ;
+		for ( int i = 0 ; i < 8 ; i ++ ) {
+			if ( inode->child[i] != NULL )
+				generateVertexIndex( inode->child[i], offset, verts ) ;
+		}
+	}
+	else if ( type == LEAF ) { // Leaf node
+		LeafNode* lnode = ((LeafNode *) node) ;
+		verts.insert( verts.end( ), lnode->mp, lnode->mp + 3 ) ; // add mp
+		lnode->index = offset;
+		offset++;
+	}
+	else if ( type == PSEUDOLEAF ) { // Pseudo leaf node
+		PseudoLeafNode* pnode = ((PseudoLeafNode *) node) ;
+		verts.insert( verts.end( ), pnode->mp, pnode->mp + 3 ) ; // add mp
+		pnode->index = offset;
+		offset++;
+	}
+}
+
+// the cell of every leaf and pseudo-leaf goes to boxes[ node->index ]
+void Octree::leafBoxes( OctreeNode* node, int st[3], int len, std::vector<BoundingBox>& boxes ) {
+	if ( node->getType( ) == INTERNAL ) {
+		InternalNode* inode = (InternalNode*) node ;
+		int nlen = len / 2 ;
+		for ( int i = 0 ; i < 8 ; i ++ ) {
+			if ( inode->child[i] != NULL ) {
+				int nst[3] = { st[0] + vertMap[i][0] * nlen, st[1] + vertMap[i][1] * nlen, st[2] + vertMap[i][2] * nlen } ;
+				leafBoxes( inode->child[i], nst, nlen, boxes ) ;
+			}
+		}
+		return ;
+	}
+	int index = ( (QEFMixin*) node )->index ;
+	if ( index < 0 )
+		return ;
+	if ( index >= (int) boxes.size( ) )
+		boxes.resize( index + 1 ) ;
+	BoundingBox& b = boxes[index] ;
+	b.begin.x = st[0] ; b.begin.y = st[1] ; b.begin.z = st[2] ;
+	b.end.x = st[0] + len ; b.end.y = st[1] + len ; b.end.z = st[2] + len ;
+}
+
+// f( leaf number ) for every leaf below node whose cell touches box, which
+// is a BoundingBox or a BoundingBoxf
+template <class B, class F>
+static void touchingLeaves( OctreeNode* node, int st[3], int len, const B& box, F& f ) {
+	if ( st[0] > box.end.x || st[1] > box.end.y || st[2] > box.end.z ||
+		 st[0] + len < box.begin.x || st[1] + len < box.begin.y || st[2] + len < box.begin.z )
+		return ;
+	if ( node->getType( ) == INTERNAL ) {
+		InternalNode* inode = (InternalNode*) node ;
+		int nlen = len / 2 ;
+		// along each axis the box touches the lower half, the upper one or both
+		int lo[3] = { box.begin.x > st[0] + nlen, box.begin.y > st[1] + nlen, box.begin.z > st[2] + nlen } ;
+		int hi[3] = { box.end.x >= st[0] + nlen, box.end.y >= st[1] + nlen, box.end.z >= st[2] + nlen } ;
+		for ( int i = 0 ; i < 8 ; i ++ ) {
+			if ( inode->child[i] == NULL ||
+				 vertMap[i][0] < lo[0] || vertMap[i][0] > hi[0] ||
+				 vertMap[i][1] < lo[1] || vertMap[i][1] > hi[1] ||
+				 vertMap[i][2] < lo[2] || vertMap[i][2] > hi[2] )
+				continue ;
+			int nst[3] = { st[0] + vertMap[i][0] * nlen, st[1] + vertMap[i][1] * nlen, st[2] + vertMap[i][2] * nlen } ;
+			touchingLeaves( inode->child[i], nst, nlen, box, f ) ;
+		}
+	}
+	else if ( ( (QEFMixin*) node )->index >= 0 ) {
+		f( ( (QEFMixin*) node )->index ) ;
+	}
+}
+
+static BoundingBoxf triangleBox( const Triangle& t ) {
+	BoundingBoxf b ;
+	b.begin.x = b.end.x = t.vt[0][0] ;
+	b.begin.y = b.end.y = t.vt[0][1] ;
+	b.begin.z = b.end.z = t.vt[0][2] ;
+	for ( int k = 1 ; k < 3 ; k ++ ) {
+		b.begin.x = std::min( b.begin.x, t.vt[k][0] ) ; b.end.x = std::max( b.end.x, t.vt[k][0] ) ;
+		b.begin.y = std::min( b.begin.y, t.vt[k][1] ) ; b.end.y = std::max( b.end.y, t.vt[k][1] ) ;
+		b.begin.z = std::min( b.begin.z, t.vt[k][2] ) ; b.end.z = std::max( b.end.z, t.vt[k][2] ) ;
+	}
+	return b ;
+}
+
+// Self-intersection test of mesh, made by genMesh() or genMeshNoInter2() of
+// this tree, without reading it back from a file. A triangle is tagged with
+// the cells of its leaf vertices and only tested against the triangles of
+// the leaves whose cells touch those, which the octree finds. Intersecting
+// pairs are written to outname like Intersection::testIntersection( fname, outname ).
+int Octree::verifyMesh( const Mesh& mesh, char* outname ) {
+	int num = mesh.numTriangles( ) ;
+	std::vector<Triangle> tris( num ) ;
+	std::vector<Triangle*> ptrs( num ) ;
+	for ( int i = 0 ; i < num ; i ++ ) {
+		for ( int k = 0 ; k < 3 ; k ++ )
+			for ( int c = 0 ; c < 3 ; c ++ )
+				tris[i].vt[k][c] = mesh.vertices[ 3 * (size_t) mesh.triangles[ 3 * (size_t) i + k ] + c ] ;
+		ptrs[i] = &tris[i] ;
+	}
+	std::vector<BoundingBox> boxes( num ) ;
+	if ( num > 0 )
+		Intersection::triangleBoxes( &ptrs[0], num, &boxes[0] ) ;
+
+	int nthreads = Parallel::numThreads( opts.numThreads ) ;
+	std::vector<int> intertris ;
+	long long numcand = 0 ;
+	double t0 = Parallel::wallTime( ) ;
+	if ( num == 0 ) {
+	}
+	else if ( mesh.cells.size( ) != (size_t) mesh.numVertices( ) ) {
+		printf("Mesh has no octree cells, searching a box tree on %d threads...\n", nthreads ) ;
+		Intersection::findIntersections( &ptrs[0], num, intertris, nthreads, &numcand ) ;
+	}
+	else {
+		printf("Testing triangles of touching cells on %d threads...\n", nthreads ) ;
+		std::vector<BoundingBox> leafBox ;
+		int st[3] = {0,0,0} ;
+		leafBoxes( root, st, dimen, leafBox ) ;
+		int numLeaves = (int) leafBox.size( ) ;
+
+		// A triangle is listed under the leaves of its vertices. If it has no
+		// leaf vertex, or one lies outside its cell (minimizers of pseudo-leaves
+		// can), it is listed under every leaf touching its own box too. So where
+		// two triangles meet, both are listed under a leaf holding that point.
+		std::vector<int> leafStart( numLeaves + 1, 0 ), leafTris ;
+		int placed = 0 ;
+		for ( int pass = 0 ; pass < 2 ; pass ++ ) {
+			for ( int i = 0 ; i < num ; i ++ ) {
+				int cell[3], n = 0, inside = 1 ;
+				for ( int k = 0 ; k < 3 ; k ++ ) {
+					unsigned int v = mesh.triangles[ 3 * (size_t) i + k ] ;
+					int c = mesh.cells[v] ;
+					if ( c < 0 )
+						continue ;
+					const BoundingBox& b = leafBox[c] ;
+					const float* p = &mesh.vertices[ 3 * (size_t) v ] ;
+					if ( p[0] < b.begin.x || p[1] < b.begin.y || p[2] < b.begin.z ||
+						 p[0] > b.end.x || p[1] > b.end.y || p[2] > b.end.z )
+						inside = 0 ;
+					if ( ( n == 0 || c != cell[0] ) && ( n < 2 || c != cell[1] ) )
+						cell[ n ++ ] = c ;
+				}
+				auto add = [&]( int l ) {
+					if ( pass == 0 )
+						leafStart[ l + 1 ] ++ ;
+					else
+						leafTris[ leafStart[l] ++ ] = i ;
+				};
+				for ( int k = 0 ; k < n ; k ++ )
+					add( cell[k] ) ;
+				if ( n == 0 || ! inside ) {
+					// the leaves of its cells come again, testCandidates() drops the repeats
+					placed += pass ;
+					BoundingBoxf fb = triangleBox( tris[i] ) ;
+					touchingLeaves( root, st, dimen, fb, add ) ;
+				}
+			}
+			if ( pass == 0 ) {
+				for ( int l = 0 ; l < numLeaves ; l ++ )
+					leafStart[ l + 1 ] += leafStart[l] ;
+				leafTris.resize( leafStart[ numLeaves ] ) ;
+			}
+			else {
+				// the fill moved every start to the next one
+				for ( int l = numLeaves ; l > 0 ; l -- )
+					leafStart[l] = leafStart[ l - 1 ] ;
+				leafStart[0] = 0 ;
+			}
+		}
+		printf(" %d of %d triangles also placed by their boxes\n", placed, num ) ;
+
+		Intersection::testCandidates( &ptrs[0], &boxes[0], num, [&]( int i, std::vector<int>& cand ) {
+			// only j < i whose boxes overlap can intersect
+			auto take = [&]( int l ) {
+				for ( int k = leafStart[l] ; k < leafStart[ l + 1 ] ; k ++ ) {
+					int j = leafTris[k] ;
+					if ( j < i && BoxTree::overlap( boxes[i], boxes[j] ) )
+						cand.push_back( j ) ;
+				}
+			};
+			// the exact box, the integer one may reach a cell further on each side
+			BoundingBoxf fb = triangleBox( tris[i] ) ;
+			int rst[3] = {0,0,0} ;
+			touchingLeaves( root, rst, dimen, fb, take ) ;
+		}, intertris, nthreads, &numcand ) ;
+	}
+	double t1 = Parallel::wallTime( ) ;
+	printf("%lld candidate pairs tested in %f seconds, %.0f pairs per second.\n",
+		numcand, t1 - t0, t1 > t0 ? numcand / ( t1 - t0 ) : 0.0 ) ;
+
+	Intersection::writeIntersections( outname, num > 0 ? &ptrs[0] : NULL, intertris ) ;
+	return (int) intertris.size( ) / 2 ;
+}
+
+// Run the calls cellProcContour( root ) makes at opts.contourDepth as jobs on
+// nthreads threads. Each job keeps its triangles, they are appended to tris
+// in job order afterwards, so the result is the same as with a single thread.
+void Octree::contourParallel( std::vector<unsigned int>& tris, int nthreads ) {
+	std::vector<ContourJob> jobs ;
+	cellProcJobs( root, 0, jobs ) ;
+	std::vector< std::vector<unsigned int> > outs( jobs.size( ) ) ;
+	printf(" Contouring %d jobs at depth %d on %d threads\n", (int) jobs.size( ), opts.contourDepth, nthreads ) ;
+
+	Parallel::parallelFor( (int) jobs.size( ), nthreads, [&]( int i, int worker ) {
+		ContourJob& job = jobs[i] ;
+		if ( job.kind == ContourJob::CELL )
+			cellProcContour( job.node[0], outs[i] ) ;
+		else if ( job.kind == ContourJob::FACE )
+			faceProcContour( job.node, job.dir, outs[i] ) ;
+		else
+			edgeProcContour( job.node, job.dir, outs[i] ) ;
+	} ) ;
+
+	for ( size_t i = 0 ; i < outs.size( ) ; i ++ ) {
+		tris.insert( tris.end( ), outs[i].begin( ), outs[i].end( ) ) ;
+		std::vector<unsigned int>( ).swap( outs[i] ) ;
+	}
+}
+
+static void addJob( std::vector<ContourJob>& jobs, int kind, OctreeNode** node, int n, int dir,
+	const int* st = NULL, int len = 0 ) {
+	ContourJob job ;
+	job.kind = kind ;
+	for ( int i = 0 ; i < 4 ; i ++ )
+		job.node[i] = i < n ? node[i] : NULL ;
+	job.dir = dir ;
+	for ( int i = 0 ; i < 3 ; i ++ )
+		job.st[i] = st != NULL ? st[i] : 0 ;
+	job.len = len ;
+	jobs.push_back( job ) ;
+}
+
+// record leaf vertex id as met by job, unless job was the last to record it
+static void touchLeaf( NoInterShared& shared, NoInterJob& job, int id ) {
+	if ( shared.leafJob[id].load( std::memory_order_relaxed ) != job.id ) {
+		shared.leafJob[id].store( job.id, std::memory_order_relaxed ) ;
+		job.events.push_back( NoInterJob::LEAF | id ) ;
+	}
+}
+
+// same recursion as cellProcContour(), nodes at depth become jobs
+void Octree::cellProcJobs( OctreeNode* node, int depth, std::vector<ContourJob>& jobs ) {
+	if ( node == NULL || node->getType() != INTERNAL )
+		return ;
+	if ( depth >= opts.contourDepth ) {
+		addJob( jobs, ContourJob::CELL, &node, 1, 0 ) ;
+		return ;
+	}
+
+	InternalNode* inode = (( InternalNode * ) node );
+	for ( int i = 0 ; i < 8 ; i ++ )
+		cellProcJobs( inode->child[ i ], depth + 1, jobs );
+
+	for ( int i = 0 ; i < 12 ; i ++ ) {
+		OctreeNode* fcd[2];
+		fcd[0] = inode->child[ cellProcFaceMask[ i ][ 0 ] ] ;
+		fcd[1] = inode->child[ cellProcFaceMask[ i ][ 1 ] ] ;
+		faceProcJobs( fcd, cellProcFaceMask[ i ][ 2 ], depth + 1, jobs ) ;
+	}
+
+	for ( int i = 0 ; i < 6 ; i ++ ) {
+		OctreeNode* ecd[4] ;
+		for ( int j = 0 ; j < 4 ; j ++ )
+			ecd[j] = inode->child[ cellProcEdgeMask[ i ][ j ] ] ;
+		edgeProcJobs( ecd, cellProcEdgeMask[ i ][ 4 ], depth + 1, jobs ) ;
+	}
+}
+
+// same recursion as faceProcContour()
+void Octree::faceProcJobs( OctreeNode* node[2], int dir, int depth, std::vector<ContourJob>& jobs ) {
+	if ( ! ( node[0] && node[1] ) )
+		return ;
+	NodeType type[2] = { node[0]->getType(), node[1]->getType() } ;
+	if ( type[0] != INTERNAL && type[1] != INTERNAL )
+		return ;
+	if ( depth >= opts.contourDepth ) {
+		addJob( jobs, ContourJob::FACE, node, 2, dir ) ;
+		return ;
+	}
+
+	OctreeNode* fcd[2] ;
+	for ( int i = 0 ; i < 4 ; i ++ ) {
+		int c[2] = { faceProcFaceMask[ dir ][ i ][ 0 ], faceProcFaceMask[ dir ][ i ][ 1 ] };
+		for ( int j = 0 ; j < 2 ; j ++ ) {
+			if ( type[j] > 0 )
+				fcd[j] = node[j];
+			else
+				fcd[j] = ((InternalNode *) node[ j ] )->child[ c[j] ];
+		}
+		faceProcJobs( fcd, faceProcFaceMask[ dir ][ i ][ 2 ], depth + 1, jobs ) ;
+	}
+
+	int orders[2][4] = {{ 0, 0, 1, 1 }, { 0, 1, 0, 1 }} ;
+	OctreeNode* ecd[4] ;
+	for ( int i = 0 ; i < 4 ; i ++ ) {
+		int c[4] = { faceProcEdgeMask[ dir ][ i ][ 1 ], faceProcEdgeMask[ dir ][ i ][ 2 ],
+					 faceProcEdgeMask[ dir ][ i ][ 3 ], faceProcEdgeMask[ dir ][ i ][ 4 ] };
+		int* order = orders[ faceProcEdgeMask[ dir ][ i ][ 0 ] ] ;
+		for ( int j = 0 ; j < 4 ; j ++ ) {
+			if ( type[order[j]] > 0 )
+				ecd[j] = node[order[j]] ;
+			else
+				ecd[j] = ( (InternalNode *) node[ order[ j ] ] )->child[ c[j] ] ;
+		}
+		edgeProcJobs( ecd, faceProcEdgeMask[ dir ][ i ][ 5 ], depth + 1, jobs ) ;
+	}
+}
+
+// same recursion as edgeProcContour()
+void Octree::edgeProcJobs( OctreeNode* node[4], int dir, int depth, std::vector<ContourJob>& jobs ) {
+	if ( ! ( node[0] && node[1] && node[2] && node[3] ) )
+		return;
+	NodeType type[4] = { node[0]->getType(), node[1]->getType(), node[2]->getType(), node[3]->getType() } ;
+	if ( depth >= opts.contourDepth || 
+		( type[0] != INTERNAL && type[1] != INTERNAL && type[2] != INTERNAL && type[3] != INTERNAL ) ) {
+		addJob( jobs, ContourJob::EDGE, node, 4, dir ) ;
+		return ;
+	}
+
+	OctreeNode* ecd[4] ;
+	for ( int i = 0 ; i < 2 ; i ++ ) {
+		for ( int j = 0 ; j < 4 ; j ++ ) {
+			if ( type[j] > 0 )
+				ecd[j] = node[j] ;
+			else
+				ecd[j] = ((InternalNode *) node[j])->child[ edgeProcEdgeMask[ dir ][ i ][ j ] ] ;
+		}
+		edgeProcJobs( ecd, edgeProcEdgeMask[ dir ][ i ][ 4 ], depth + 1, jobs ) ;
+	}
+}
+
+// cellProcContour( this->root ) is the entry-point to the entire algorithm
+void Octree::cellProcContour( OctreeNode* node, std::vector<unsigned int>& tris )  {
+	if ( node == NULL )
+		return ;
+
+	int type = node->getType() ;
+
+	if ( type == INTERNAL ) { // internal node
+		InternalNode* inode = (( InternalNode * ) node );
+		for ( int i = 0 ; i < 8 ; i ++ ) // 8 Cell calls on children
+			cellProcContour( inode->child[ i ], tris );
+
+		for ( int i = 0 ; i < 12 ; i ++ ) {  // 12 face calls, faces between each child node
+			int c[ 2 ] = { cellProcFaceMask[ i ][ 0 ], cellProcFaceMask[ i ][ 1 ] };
+			OctreeNode* fcd[2];
+			fcd[0] = inode->child[ c[0] ] ;
+			fcd[1] = inode->child[ c[1] ] ;
+			faceProcContour( fcd, cellProcFaceMask[ i ][ 2 ], tris ) ;
+		}
+
+		for ( int i = 0 ; i < 6 ; i ++ ) {  // 6 edge calls
+			int c[ 4 ] = { cellProcEdgeMask[ i ][ 0 ], cellProcEdgeMask[ i ][ 1 ], cellProcEdgeMask[ i ][ 2 ], cellProcEdgeMask[ i ][ 3 ] };
+			OctreeNode* ecd[4] ;
+			for ( int j = 0 ; j < 4 ; j ++ )
+				ecd[j] = inode->child[ c[j] ] ;
+
+			edgeProcContour( ecd, cellProcEdgeMask[ i ][ 4 ], tris ) ;
+		}
+	}
+};
+
+// node[2] are the two nodes that share a face
+// dir comes from cellProcFaceMask[i][2]  where i=0..11
+void Octree::faceProcContour ( OctreeNode* node[2], int dir, std::vector<unsigned int>& tris )  {
+	// printf("I am at a face! %d\n", dir ) ;
+	if ( ! ( node[0] && node[1] ) ) {
+		// printf("I am none.\n") ;
+		return ;
+	}
+
+	NodeType type[2] = { node[0]->getType(), node[1]->getType() } ;
+
+	if ( type[0] == INTERNAL || type[1] == INTERNAL ) { // both nodes internal
+		// 4 face calls
+		OctreeNode* fcd[2] ;
+		for ( int i = 0 ; i < 4 ; i ++ ) {
+			int c[2] = { faceProcFaceMask[ dir ][ i ][ 0 ], faceProcFaceMask[ dir ][ i ][ 1 ] };
+			for ( int j = 0 ; j < 2 ; j ++ ) {
+				if ( type[j] > 0 )
+					fcd[j] = node[j];
+				else 
+					fcd[j] = ((InternalNode *) node[ j ] )->child[ c[j] ];
+			}
+			faceProcContour( fcd, faceProcFaceMask[ dir ][ i ][ 2 ], tris ) ;
+		}
+
+		// 4 edge calls
+		int orders[2][4] = {{ 0, 0, 1, 1 }, { 0, 1, 0, 1 }} ;
+		OctreeNode* ecd[4] ;
+			
+		for ( int i = 0 ; i < 4 ; i ++ ) {
+			int c[4] = { faceProcEdgeMask[ dir ][ i ][ 1 ], faceProcEdgeMask[ dir ][ i ][ 2 ],
+						 faceProcEdgeMask[ dir ][ i ][ 3 ], faceProcEdgeMask[ dir ][ i ][ 4 ] };
+			int* order = orders[ faceProcEdgeMask[ dir ][ i ][ 0 ] ] ;
+
+			for ( int j = 0 ; j < 4 ; j ++ ) {
+				if ( type[order[j]] > 0 )
+					ecd[j] = node[order[j]] ;
+				else
+					ecd[j] = ( (InternalNode *) node[ order[ j ] ] )->child[ c[j] ] ;
+			}
+			edgeProcContour( ecd, faceProcEdgeMask[ dir ][ i ][ 5 ], tris ) ;
+		}
+//		printf("I am done.\n") ;
+	}
+	else {
+//		printf("I don't have any children.\n") ;
+	}
+};
+
+// a common edge between four nodes in node[4]
+// "dir" comes from cellProcEdgeMask
+void Octree::edgeProcContour ( OctreeNode* node[4], int dir, std::vector<unsigned int>& tris ) {
+	if ( ! ( node[0] && node[1] && node[2] && node[3] ) )
+		return;
+
+	NodeType type[4] = { node[0]->getType(), node[1]->getType(), node[2]->getType(), node[3]->getType() } ;
+
+	if ( type[0] != INTERNAL && type[1] != INTERNAL  && type[2] != INTERNAL && type[3] != INTERNAL ) {
+		processEdgeWrite( node, dir, tris ) ; // a face (quad?) is output
+	} else {
+		// 2 edge calls
+		OctreeNode* ecd[4] ;
+		for ( int i = 0 ; i < 2 ; i ++ ) {
+			int c[ 4 ] = { edgeProcEdgeMask[ dir ][ i ][ 0 ], 
+						   edgeProcEdgeMask[ dir ][ i ][ 1 ], 
+						   edgeProcEdgeMask[ dir ][ i ][ 2 ], 
+						   edgeProcEdgeMask[ dir ][ i ][ 3 ] } ;
+
+			for ( int j = 0 ; j < 4 ; j ++ ) {
+				if ( type[j] > 0 )
+					ecd[j] = node[j] ;
+				else
+					ecd[j] = ((InternalNode *) node[j])->child[ c[j] ] ;
+			}
+
+			edgeProcContour( ecd, edgeProcEdgeMask[ dir ][ i ][ 4 ], tris ) ;
+		}
+
+	}
+};
+
+// one triangle of processEdgeWrite() and processEdgeNoInter2()
+static void addTriangle( std::vector<unsigned int>& tris, int tind[3] ) {
+	for ( int i = 0 ; i < 3 ; i ++ )
+		tris.push_back( tind[i] ) ;
+}
+
+// this adds a face to tris
+// vertices already have their index
+// so here we add topology only, i.e. sets of indices that form a face
+void Octree::processEdgeWrite ( OctreeNode* node[4], int dir, std::vector<unsigned int>& tris )  {
+	// Get minimal cell
+	int type, ht, minht = this->maxDepth+1, mini = -1 ;
+	int ind[4], sc[4], flip[4] = {0,0,0,0} ;
+	int flip2;
+	for ( int i = 0 ; i < 4 ; i ++ ) {
+		if ( node[i]->getType() == LEAF ) {
+			LeafNode* lnode = ((LeafNode *) node[i]) ;
+			int ed = processEdgeMask[dir][i] ;
+			int c1 = edgevmap[ed][0] ;
+			int c2 = edgevmap[ed][1] ;
+
+			if ( lnode->height < minht ) {
+				minht = lnode->height ;
+				mini = i ;
+				if ( lnode->getSign(c1) > 0 )
+					flip2 = 1 ;
+				else
+					flip2 = 0 ;
+			}
+			ind[i] = lnode->index ;
+
+			if ( lnode->getSign( c1 ) == lnode->getSign( c2 ) )
+				sc[ i ] = 0 ;
+			else
+				sc[ i ] = 1 ;
+
+//				if ( lnode->getSign(c1) > 0 )
+//				{
+//					flip[ i ] = 1 ;
+//				}
+			// }
+		} else {
+			assert( node[i]->getType() == PSEUDOLEAF );
+			PseudoLeafNode* pnode = ((PseudoLeafNode *) node[i]) ;
+
+			int ed = processEdgeMask[dir][i] ;
+			int c1 = edgevmap[ed][0] ;
+			int c2 = edgevmap[ed][1] ;
+
+			if ( pnode->height < minht ) {
+				minht = pnode->height;
+				mini = i;
+				if ( pnode->getSign(c1) > 0 )
+					flip2 = 1 ;
+				else
+					flip2 = 0 ;
+			}
+			ind[i] = pnode->index ;
+
+			if ( pnode->getSign( c1 ) == pnode->getSign( c2 ) )
+				sc[ i ] = 0 ;
+			else
+				sc[ i ] = 1 ;
+
+//				if ( pnode->getSign(c1) > 0 )
+//				{
+//					flip[ i ] = 1 ;
+//					flip2 = 1 ;
+//				}
+//			}
+		}
+
+	}
+
+	if ( sc[ mini ] == 1 ) { // condition for any triangle output?
+		if ( flip2 == 0 ) {
+			if ( ind[0] == ind[1] ) { // two indices same, so output triangle
+				int tind[] = { ind[0], ind[3], ind[2] } ;
+				addTriangle( tris, tind ) ;
+			} else if ( ind[1] == ind[3] ) {
+				int tind[] = { ind[0], ind[1], ind[2] } ;
+				addTriangle( tris, tind ) ;
+			} else if ( ind[3] == ind[2] ) {
+				int tind[] = { ind[0], ind[1], ind[3] } ;
+				addTriangle( tris, tind ) ;
+			} else if ( ind[2] == ind[0] ) {
+				int tind[] = { ind[1], ind[3], ind[2] } ;
+				addTriangle( tris, tind ) ;
+			} else { // all indices unique, so output a quad by outputting two triangles
+				int tind1[] = { ind[0], ind[1], ind[3] } ;
+				addTriangle( tris, tind1 ) ;
+				int tind2[] = { ind[0], ind[3], ind[2] } ;
+				addTriangle( tris, tind2 ) ;
+			}
+		} else {
+			if ( ind[0] == ind[1] ) {
+				int tind[] = { ind[0], ind[2], ind[3] } ;
+				addTriangle( tris, tind ) ;
+			} else if ( ind[1] == ind[3] ) {
+				int tind[] = { ind[0], ind[2], ind[1] } ;
+				addTriangle( tris, tind ) ;
+			} else if ( ind[3] == ind[2] ) {
+				int tind[] = { ind[0], ind[3], ind[1] } ;
+				addTriangle( tris, tind ) ;
+			} else if ( ind[2] == ind[0] ) {
+				int tind[] = { ind[1], ind[2], ind[3] } ;
+				addTriangle( tris, tind ) ;
+			} else {
+				int tind1[] = { ind[0], ind[3], ind[1] } ;
+				addTriangle( tris, tind1 ) ;
+				int tind2[] = { ind[0], ind[2], ind[3] } ;
+				addTriangle( tris, tind2 ) ;
+			}
+		}
+	}
+};
+
+
+// used initially for counting number of vertices
+// genContour calls cellProcCount(root) and this is a recursive function
+void Octree::cellProcCount( OctreeNode* node, int& nverts, int& nfaces )  {
+	if ( node == NULL )
+		return ;
+
+	int type = node->getType() ;
+
+	if (type != INTERNAL)
+		nverts ++ ; // !internal, so leaf or pseudoleaf node produces a vertex
+	else { 
+		// recurse into tree
+		InternalNode* inode = (( InternalNode * ) node ) ;
+		
+		for ( int i = 0 ; i < 8 ; i ++ ) // 8 recursive calls to child nodes
+			cellProcCount( inode->child[ i ], nverts, nfaces ) ;
+
+		OctreeNode* fcd[2];
+		for ( int i = 0 ; i < 12 ; i ++ ) {  // 12 face calls. among the 8 child-nodes there are 12 common faces
+			int c[ 2 ] = { cellProcFaceMask[ i ][ 0 ], cellProcFaceMask[ i ][ 1 ] };
+			fcd[0] = inode->child[ c[0] ] ;
+			fcd[1] = inode->child[ c[1] ] ;
+			faceProcCount( fcd, cellProcFaceMask[ i ][ 2 ], nverts, nfaces ); // 2nd argument is "dir"
+		}
+
+		OctreeNode* ecd[4] ;
+		for ( int i = 0 ; i < 6 ; i ++ ) { // 6 edge calls
+			int c[ 4 ] = { cellProcEdgeMask[ i ][ 0 ], cellProcEdgeMask[ i ][ 1 ], cellProcEdgeMask[ i ][ 2 ], cellProcEdgeMask[ i ][ 3 ] };
+			for ( int j = 0 ; j < 4 ; j ++ )
+				ecd[j] = inode->child[ c[j] ] ;
+			edgeProcCount( ecd, cellProcEdgeMask[ i ][ 4 ], nverts, nfaces ) ;
+		}
+	}
+};
+
+void Octree::faceProcCount ( OctreeNode* node[2], int dir, int& nverts, int& nfaces ) {
+	if ( ! ( node[0] && node[1] ) ) 
+		return ;
+	
+	int type[2] = { node[0]->getType(), node[1]->getType() } ;
+
+	if ( type[0] == INTERNAL || type[1] == INTERNAL ) {
+		OctreeNode* fcd[2] ; 
+		for ( int i = 0 ; i < 4 ; i ++ ) { // 4 face calls, recursive!
+			int c[2] = { faceProcFaceMask[ dir ][ i ][ 0 ], faceProcFaceMask[ dir ][ i ][ 1 ] };
+			for ( int j = 0 ; j < 2 ; j ++ ) {
+				if ( type[j] != INTERNAL )
+					fcd[j] = node[j] ;
+				else
+					fcd[j] = ((InternalNode *) node[ j ] )->child[ c[j] ] ;
+			}
+			faceProcCount( fcd, faceProcFaceMask[ dir ][ i ][ 2 ], nverts, nfaces ) ;
+		}
+
+		int orders[2][4] = {{ 0, 0, 1, 1 }, { 0, 1, 0, 1 }} ;
+		OctreeNode* ecd[4] ;
+			
+		for ( int i = 0 ; i < 4 ; i ++ ) {  // 4 edge calls
+			int c[4] = { faceProcEdgeMask[ dir ][ i ][ 1 ], faceProcEdgeMask[ dir ][ i ][ 2 ],
+						 faceProcEdgeMask[ dir ][ i ][ 3 ], faceProcEdgeMask[ dir ][ i ][ 4 ] };
+			int* order = orders[ faceProcEdgeMask[ dir ][ i ][ 0 ] ] ;
+
+			for ( int j = 0 ; j < 4 ; j ++ ) {
+				if ( type[order[j]] != INTERNAL )
+					ecd[j] = node[order[j]] ;
+				else
+					ecd[j] = ( (InternalNode *) node[ order[ j ] ] )->child[ c[j] ] ;
+			}
+
+			edgeProcCount( ecd, faceProcEdgeMask[ dir ][ i ][ 5 ], nverts, nfaces ) ;
+		}
+	}
+};
+
+void Octree::edgeProcCount ( OctreeNode* node[4], int dir, int& nverts, int& nfaces ) {
+	if ( ! ( node[0] && node[1] && node[2] && node[3] ) )
+		return ;
+
+	int type[4] = { node[0]->getType(), node[1]->getType(), node[2]->getType(), node[3]->getType() } ;
+	if ( type[0] != INTERNAL && type[1] != INTERNAL && type[2] != INTERNAL && type[3] != INTERNAL )
+		processEdgeCount( node, dir, nverts, nfaces ) ;
+	else {
+		// 2 edge calls
+		OctreeNode* ecd[4] ;
+		for ( int i = 0 ; i < 2 ; i ++ ) {
+			int c[ 4 ] = { edgeProcEdgeMask[ dir ][ i ][ 0 ], 
+						   edgeProcEdgeMask[ dir ][ i ][ 1 ], 
+						   edgeProcEdgeMask[ dir ][ i ][ 2 ], 
+						   edgeProcEdgeMask[ dir ][ i ][ 3 ] } ;
+
+			for ( int j = 0 ; j < 4 ; j ++ ) {
+				if ( type[j] != INTERNAL )
+					ecd[j] = node[j] ;
+				else
+					ecd[j] = ((InternalNode *) node[j])->child[ c[j] ] ;
+			}
+			edgeProcCount( ecd, edgeProcEdgeMask[ dir ][ i ][ 4 ], nverts, nfaces ) ;
+		}
+	}
+};
+
+void Octree::processEdgeCount ( OctreeNode* node[4], int dir, int& nverts, int& nfaces )  {
+	// Get minimal cell
+	int i, type, ht, minht = maxDepth+1, mini = -1 ;
+	int ind[4], sc[4], flip[4] = {0,0,0,0} ;
+	for ( i = 0 ; i < 4 ; i ++ ) {
+		if ( node[i]->getType() == 1 ) {
+			LeafNode* lnode = ((LeafNode *) node[i]) ;
+
+			if ( lnode->height < minht ) {
+				minht = lnode->height ;
+				mini = i ;
+			}
+			ind[i] = lnode->index ;
+
+			int ed = processEdgeMask[dir][i] ;
+			int c1 = edgevmap[ed][0] ;
+			int c2 = edgevmap[ed][1] ;
+
+			if ( lnode->getSign( c1 ) == lnode->getSign( c2 ) ) {
+				sc[ i ] = 0 ;
+			}
+			else {
+				sc[ i ] = 1 ;
+				if ( lnode->getSign(c1) > 0 )
+					flip[ i ] = 1 ;
+			}
+		}
+		else {
+			PseudoLeafNode* pnode = ((PseudoLeafNode *) node[i]) ;
+			if ( pnode->height < minht ) {
+				minht = pnode->height ;
+				mini = i ;
+			}
+			ind[i] = pnode->index ;
+
+			int ed = processEdgeMask[dir][i] ;
+			int c1 = edgevmap[ed][0] ;
+			int c2 = edgevmap[ed][1] ;
+
+			if ( pnode->getSign( c1 ) == pnode->getSign( c2 ) ) {
+				sc[ i ] = 0 ;
+			}
+			else {
+				sc[ i ] = 1 ;
+				if ( pnode->getSign(c1) > 0 )
+					flip[ i ] = 1 ;
+			}
+		}
+	}
+
+	if ( sc[ mini ] == 1 ) {
+		nfaces ++ ; // triangle
+		if ( node[0] != node[1] && node[1] != node[3] && node[3] != node[2] && node[2] != node[0] )
+			nfaces ++ ; // quad, so two triangles
+	}
+
+};
+
+/************************************************************************/
+/* Start intersection free algorithm                               */
+/************************************************************************/
+
+
+
+int Octree::testFace( int st[3], int len, int dir, float v1[3], float v2[3] ) 
+{
+#ifdef TESS_UNIFORM
+	return 0 ;
+#endif
+
+#ifdef TESS_NONE
+	return 1 ;
+#endif
+	float vec[3] = { v2[0]-v1[0], v2[1]-v1[1], v2[2]-v1[2] } ;
+	float ed1[3]={0,0,0}, ed2[3] = {0,0,0};
+	ed1[(dir+1)%3]=1;
+	ed2[(dir+2)%3]=1;
+
+	// the two axes in lanes 0 and 1, repeated in 2 and 3
+	float ax[3][4] ;
+	Intersection::cross( ed1, vec, ax, 0 ) ;
+	Intersection::cross( ed2, vec, ax, 1 ) ;
+	Intersection::cross( ed1, vec, ax, 2 ) ;
+	Intersection::cross( ed2, vec, ax, 3 ) ;
+
+	// segment v1 v2 against the triangle of the face at st
+	float seg[2][3][4], face[3][3][4] ;
+	Intersection::spread( v1, seg[0] ) ;
+	Intersection::spread( v2, seg[1] ) ;
+	float corner[3][3] ;
+	for ( int i = 0 ; i < 3 ; i ++ )
+	{
+		corner[0][i] = st[i] ;
+		corner[1][i] = st[i] ;
+		corner[2][i] = st[i] ;
+	}
+	corner[1][(dir+1)%3] += len ;
+	corner[2][(dir+2)%3] += len ;
+	for ( int i = 0 ; i < 3 ; i ++ )
+	{
+		Intersection::spread( corner[i], face[i] ) ;
+	}
+
+	if ( Intersection::separating4( ax, seg, 2, face, 3 ) )
+	{
+		return 0 ;
+	}
+	else
+	{
+		return 1 ;
+	}
+};
+
+int Octree::testEdge( int st[3], int len, int dir, OctreeNode* node[4], float v[4][3] ) 
+{
+#ifdef TESS_UNIFORM
+	return 0 ;
+#endif
+
+#ifdef TESS_NONE
+	return 1 ;
+#endif
+
+	if ( node[0] == node[1] || node[1] == node[3] || node[3] == node[2] || node[2] == node[0] )
+	{
+//		return 1 ;
+	}
+
+	float p1[3] ={st[0], st[1], st[2]};
+	float p2[3] ={st[0], st[1], st[2]};
+	p2[dir] += len ;
+
+	int nbr[]={0,1,3,2,0} ;
+	int nbr2[]={3,2,0,1,3} ;
+	float vec1[4][3], vec2[4][3] ;
+
+	for ( int i = 0 ; i < 4 ; i ++ )
+	{
+		for ( int j = 0 ; j < 3 ; j ++ )
+		{
+			vec1[i][j] = v[i][j] - p1[j] ;
+			vec2[i][j] = v[i][j] - p2[j] ;
+		}
+	}
+
+#ifdef EDGE_TEST_CONVEXITY
+	// lane i: the plane through an end of the dual edge and the vertices
+	// nbr[i], nbr[i+1] must not have nbr2[i] and nbr2[i+1] on opposite sides
+	float origin[1][3][4] = {} ;
+	for ( int end = 0 ; end < 2 ; end ++ )
+	{
+		float (*vec)[3] = end == 0 ? vec1 : vec2 ;
+		float ax[3][4], pts[2][3][4] ;
+		int skip = 0 ;
+		for ( int i = 0 ; i < 4 ; i ++ )
+		{
+			int a = nbr[i] ;
+			int b = nbr[i+1] ;
+			if ( node[a] == node[b] )
+			{
+				skip |= 1 << i ;
+			}
+			Intersection::cross( vec[a], vec[b], ax, i ) ;
+			for ( int k = 0 ; k < 3 ; k ++ )
+			{
+				pts[0][k][i] = vec[nbr2[i]][k] ;
+				pts[1][k][i] = vec[nbr2[i+1]][k] ;
+			}
+		}
+
+		if ( ~Intersection::separating4( ax, origin, 1, pts, 2 ) & ~skip & 15 )
+		{
+			return 0 ;
+		}
+	}
+#else
+#ifdef EDGE_TEST_FLIPDIAGONAL
+	float t1[3][3], t2[3][3] ;
+	int tri[2][2][4] = {{{0,1,3,2},{3,2,0,1}},{{2,0,1,3},{1,3,2,0}}} ;
+	for ( int i = 0 ; i < 2 ; i ++ )
+	{
+		int good = 1 ;
+		for ( int j = 0 ; j < 2 ; j ++ )
+		{
+			// Top
+			for ( int k = 0 ; k < 3 ; k ++ )
+			{
+				t1[0][k] = v[tri[i][j][0]][k] ;
+				t1[1][k] = v[tri[i][j][1]][k] ;
+				t1[2][k] = v[tri[i][j][2]][k] ;
+
+				t2[0][k] = p1[k] ;
+				t2[1][k] = v[tri[i][j][2]][k] ;
+				t2[2][k] = v[tri[i][j][3]][k] ;
+			}
+
+			if ( Intersection::testIntersection( t1, t2 ) )
+			{
+				good = 0 ;
+				break ;
+			}
+			
+			// Bottom
+			for ( int k = 0 ; k < 3 ; k ++ )
+			{
+				t2[0][k] = p2[k] ;
+			}
+			
+			if ( Intersection::testIntersection( t1, t2 ) )
+			{
+				good = 0 ;
+				break ;
+			}
+		}
+
+		if ( good )
+		{
+			return (i+1) ;
+		}
+	}
+	return 0 ;
+
+#else
+#ifdef EDGE_TEST_NEW
+	// Lane 2i+j: triangulation i starting with triangle j. First the
+	// triangle against the dual edge along its normal, then the diagonal
+	// against the triangle of the dual edge and the fourth vertex along
+	// the cross products of their edges. All lanes are tested, the
+	// first one that nothing separates wins.
+	int tri[2][2][4] = {{{0,1,3,2},{3,2,0,1}},{{2,0,1,3},{1,3,2,0}}} ;
+	float ax[3][4], ax1[3][4], ax2[3][4], ax3[3][4] ;
+	float t1[3][3][4], edge[2][3][4], t2[3][3][4], diag[2][3][4] ;
+	Intersection::spread( p1, edge[0] ) ;
+	Intersection::spread( p2, edge[1] ) ;
+	Intersection::spread( p1, t2[0] ) ;
+	Intersection::spread( p2, t2[1] ) ;
+	for ( int l = 0 ; l < 4 ; l ++ )
+	{
+		int* q = tri[l / 2][l % 2] ;
+		float vec1[3], vec2[3], vec3[3], vec[3] ;
+		for ( int k = 0 ; k < 3 ; k ++ )
+		{
+			t1[0][k][l] = v[q[0]][k] ;
+			t1[1][k][l] = v[q[1]][k] ;
+			t1[2][k][l] = v[q[2]][k] ;
+			vec1[k] = v[q[1]][k] - v[q[0]][k] ;
+			vec2[k] = v[q[2]][k] - v[q[1]][k] ;
+		}
+		Intersection::cross( vec1, vec2, ax, l ) ;
+
+		for ( int k = 0 ; k < 3 ; k ++ )
+		{
+			t2[2][k][l] = v[q[3]][k] ;
+			diag[0][k][l] = v[q[0]][k] ;
+			diag[1][k][l] = v[q[2]][k] ;
+			vec1[k] = p2[k] - p1[k] ;
+			vec2[k] = v[q[3]][k] - p2[k] ;
+			vec3[k] = p1[k] - v[q[3]][k] ;
+			vec[k] = v[q[2]][k] - v[q[0]][k] ;
+		}
+		Intersection::cross( vec1, vec, ax1, l ) ;
+		Intersection::cross( vec2, vec, ax2, l ) ;
+		Intersection::cross( vec3, vec, ax3, l ) ;
+	}
+
+	int sep = Intersection::separatingTol4( ax, t1, 3, edge, 2 ) |
+		Intersection::separatingTol4( ax1, t2, 3, diag, 2 ) |
+		Intersection::separatingTol4( ax2, t2, 3, diag, 2 ) |
+		Intersection::separatingTol4( ax3, t2, 3, diag, 2 ) ;
+	for ( int l = 0 ; l < 4 ; l ++ )
+	{
+		if ( ! ( sep & ( 1 << l ) ) )
+		{
+			return ( l / 2 + 1 ) ;
+		}
+	}
+	return 0 ;
+
+
+#endif
+
+#endif
+#endif
+	
+	return 1 ;
+};
+
+
+void Octree::makeEdgeVertex( int st[3], int len, int dir, OctreeNode* node[4], float mp[4][3], float v[3] ) 
+{
+	int nlen = len / 2 ;
+	v[0] = st[0] ;
+	v[1] = st[1] ;
+	v[2] = st[2] ;
+	v[dir] += nlen ;
+
+	//return ;
+
+//	if ( this->hasQEF == 0 )
+//	{
+//		return ;
+//	}
+
+
+	/* QEF based method 
+
+	int i, j ;
+	float ata[6] = { 0, 0, 0, 0, 0, 0 };
+	float atb[3] = { 0, 0, 0 } ;
+	float btb = 0 ;
+
+	// Gather QEF
+	for ( j = 0 ; j < 4 ; j ++ )
+	{
+		if ( node[j]->getType() == 1 )
+		{
+			LeafNode* lnode = ((LeafNode *) node[j]) ;
+			for ( i = 0 ; i < 6 ; i ++ )
+			{
+				ata[i] += qefPool.get( lnode->qef ).ata[i] ;
+			}
+			for ( i = 0 ; i < 3 ; i ++ )
+			{
+				atb[i] += qefPool.get( lnode->qef ).atb[i] ;
+			}
+			btb += qefPool.get( lnode->qef ).btb ;
+		}
+		else
+		{
+			PseudoLeafNode* lnode = ((PseudoLeafNode *) node[j]) ;
+			for ( i = 0 ; i < 6 ; i ++ )
+			{
+				ata[i] += qefPool.get( lnode->qef ).ata[i] ;
+			}
+			for ( i = 0 ; i < 3 ; i ++ )
+			{
+				atb[i] += qefPool.get( lnode->qef ).atb[i] ;
+			}
+			btb += qefPool.get( lnode->qef ).btb ;
+		}
+	}
+
+	// Find coefficient A and b
+	float A, b ;
+	switch ( dir )
+	{
+	case 0 : 
+		A = ata[ 0 ] ;
+		b = atb[ 0 ] - ata[ 1 ] * st[ 1 ] - ata[ 2 ] * st[ 2 ] ;
+		break ;
+	case 1 :
+		A = ata[ 3 ] ;
+		b = atb[ 1 ] - ata[ 1 ] * st[ 0 ] - ata[ 4 ] * st[ 2 ] ;
+		break ;
+	case 2 :
+		A = ata[ 5 ] ;
+		b = atb[ 2 ] - ata[ 2 ] * st[ 0 ] - ata[ 4 ] * st[ 1 ] ;
+		break ;
+	}
+
+	if ( A == 0 )
+	{
+		printf("A is zero!\n") ;
+		return ;
+	}
+	else
+	{
+		v[ dir ] = b / A ;
+		if ( v[ dir ] < st[ dir ] )
+		{
+			v[ dir ] = st[ dir ] ;
+		}
+		else if ( v[ dir ] > st[ dir ] + len)
+		{
+			v[ dir ] = st[ dir ] + len ;
+		}
+	}
+	*/
+
+
+	/* Barycentric approach */
+	float pt[4][2], pv[4], x[2] ;
+	int dir2 = ( dir + 1 ) % 3 ;
+	int dir3 = ( dir2 + 1 ) % 3 ;
+	int seq[] = {0,1,3,2} ;
+	float epsilon = 0.000001f;
+
+	for ( int i = 0 ; i < 4 ; i ++ )
+	{
+		pt[ i ][ 0 ] = mp[ seq[i] ][ dir2 ] ;
+		pt[ i ][ 1 ] = mp[ seq[i] ][ dir3 ] ;
+		pv[ i ] = mp[ seq[i] ][ dir ] ;
+	}
+	x[ 0 ] = st[ dir2 ] ;
+	x[ 1 ] = st[ dir3 ] ;
+
+	// Compute mean-value interpolation
+
+	float vec[4][2], d[4] ;
+	for ( int i = 0 ; i < 4 ; i ++ )
+	{
+		vec[i][0] = pt[i][0] - x[0] ;
+		vec[i][1] = pt[i][1] - x[1] ;
+
+		d[i] = sqrt( vec[i][0] * vec[i][0] + vec[i][1] * vec[i][1] );
+
+		if ( d[i] < epsilon )
+		{
+			
+			v[ dir ] = pv[ i ] ;
+			if ( v[dir] < st[dir] )
+			{
+				v[dir] = st[dir] ;
+			}
+			else if ( v[dir] > st[dir] + len )
+			{
+				v[dir] = st[dir] + len ;
+			}
+			
+			return ;
+		}
+	}
+
+	float w[4]={0,0,0,0}, totw = 0 ;
+	for ( int i = 0 ; i < 4 ; i ++ )
+	{
+		int i2 = ( i + 1 ) % 4 ;
+		float sine = ( vec[i][0] * vec[i2][1] - vec[i][1] * vec[i2][0] ) / ( d[i] * d[i2] ) ;
+		float cosine = ( vec[i][0] * vec[i2][0] + vec[i][1] * vec[i2][1] ) / ( d[i] * d[i2] ) ;
+
+		if ( fabs(cosine + 1) < epsilon )
+		{
+			v[ dir ] = ( pv[ i ] * d[i2] + pv[ i2 ] * d[i] ) / (d[i] + d[i2]);
+			
+			if ( v[dir] < st[dir] )
+			{
+				v[dir] = st[dir] ;
+			}
+			else if ( v[dir] > st[dir] + len )
+			{
+				v[dir] = st[dir] + len ;
+			}
+			
+			return ;
+		}
+
+		float tan2 = sine / ( 1 + cosine ) ;
+
+		w[i] += ( tan2 / d[i] ) ; 
+		w[i2] += ( tan2 / d[i2] ) ; 
+
+		totw += ( tan2 / d[i] ) ;
+		totw += ( tan2 / d[i2] ) ;
+	}
+
+	v[dir] = 0 ;
+	for ( int i = 0 ; i < 4 ; i ++ )
+	{
+		v[dir] += ( w[i] * pv[ i ] / totw );
+	}
+	/**/
+	if ( v[dir] < st[dir] )
+	{
+		v[dir] = st[dir] ;
+	}
+	else if ( v[dir] > st[dir] + len )
+	{
+		v[dir] = st[dir] + len ;
+	}
+	
+};
+
+
+void Octree::cellProcContourNoInter2( OctreeNode* node, int st[3], int len, int depth, NoInterShared& shared, NoInterJob& job )
+{
+//	printf("I am at a cell! %d %d %d, %d \n", st[0], st[1], st[2], len ) ;	
+	if ( node == NULL )
+	{
+//		printf("Empty cell.\n") ;
+		return ;
+	}
+
+	int type = node->getType() ;
+
+	if ( type == 0 )
+	{
+		if ( job.plan != NULL && depth >= opts.contourDepth )
+		{
+			addJob( *job.plan, ContourJob::CELL, &node, 1, 0, st, len ) ;
+			return ;
+		}
+		InternalNode* inode = (( InternalNode * ) node ) ;
+
+		// 8 Cell calls
+//			printf("Process cell calls!\n") ;
+		int nlen = len / 2 ;
+		int nst[3] ;
+
+		for ( int i = 0 ; i < 8 ; i ++ )
+		{
+//			printf("Cell %d..\n", i) ;
+			nst[0] = st[0] + vertMap[i][0] * nlen ;
+			nst[1] = st[1] + vertMap[i][1] * nlen ;
+			nst[2] = st[2] + vertMap[i][2] * nlen ;
+			cellProcContourNoInter2( inode->child[ i ], nst, nlen, depth + 1, shared, job ) ;
+//		printf("Return from %d %d %d, %d \n", nst[0], nst[1], nst[2], nlen ) ;	
+		}
+//					printf("I am done with cells!\n") ;
+
+		// 12 face calls
+//			printf("Process face calls!\n") ;
+		OctreeNode* fcd[2] ;
+		int dirCell2[3][4][3] = {
+			{{0,-1,-1},{0,-1,0},{0,0,-1},{0,0,0}},
+			{{-1,0,-1},{0,0,-1},{-1,0,0},{0,0,0}},
+			{{-1,-1,0},{-1,0,0},{0,-1,0},{0,0,0}}};
+		for ( int i = 0 ; i < 3 ; i ++ )
+			for ( int j = 0 ; j < 4 ; j ++ )
+			{
+				nst[0] = st[0] + nlen + dirCell2[i][j][0] * nlen ;
+				nst[1] = st[1] + nlen + dirCell2[i][j][1] * nlen ;
+				nst[2] = st[2] + nlen + dirCell2[i][j][2] * nlen ;
+				
+				int ed = i * 4 + j ;
+				int c[ 2 ] = { cellProcFaceMask[ ed ][ 0 ], cellProcFaceMask[ ed ][ 1 ] };
+				
+				fcd[0] = inode->child[ c[0] ] ;
+				fcd[1] = inode->child[ c[1] ] ;
+				
+				faceProcContourNoInter2( fcd, nst, nlen, cellProcFaceMask[ ed ][ 2 ], depth + 1, shared, job ) ;
+			}
+//					printf("I am done with faces!\n") ;
+
+		// 6 edge calls
+//			printf("Process edge calls!\n") ;
+		OctreeNode* ecd[4] ;
+		for ( int i = 0 ; i < 6 ; i ++ )
+		{
+			int c[ 4 ] = { cellProcEdgeMask[ i ][ 0 ], cellProcEdgeMask[ i ][ 1 ], cellProcEdgeMask[ i ][ 2 ], cellProcEdgeMask[ i ][ 3 ] };
+
+			for ( int j = 0 ; j < 4 ; j ++ )
+			{
+				ecd[j] = inode->child[ c[j] ] ;
+			}
+
+			int dir = cellProcEdgeMask[ i ][ 4 ] ;
+			nst[0] = st[0] + nlen ;
+			nst[1] = st[1] + nlen ;
+			nst[2] = st[2] + nlen ;
+			if ( i % 2 == 0 )
+			{
+				nst[ dir ] -= nlen ;
+			}
+
+			edgeProcContourNoInter2( ecd, nst, nlen, dir, depth + 1, shared, job ) ;
+		}
+//					printf("I am done with edges!\n") ;
+
+	}
+//	printf("I am done with cell %d %d %d, %d \n", st[0], st[1], st[2], len ) ;	
+};
+
+void Octree::faceProcContourNoInter2( OctreeNode* node[2], int st[3], int len, int dir, int depth, NoInterShared& shared, NoInterJob& job )
+{
+//	printf("I am at a face! %d %d %d, %d, %d\n", st[0], st[1], st[2], len, dir ) ;
+	if ( ! ( node[0] && node[1] ) )
+	{
+//		printf("I am none.\n") ;
+		return ;
+	}
+
+	int type[2] = { node[0]->getType(), node[1]->getType() } ;
+
+	if ( type[0] == 0 || type[1] == 0 )
+	{
+		if ( job.plan != NULL && depth >= opts.contourDepth )
+		{
+			addJob( *job.plan, ContourJob::FACE, node, 2, dir, st, len ) ;
+			return ;
+		}
+		int i, j ;
+		int nlen = len / 2 ;
+		int nst[3] ;
+
+		// 4 face calls
+		OctreeNode* fcd[2] ;
+		int iface = faceProcFaceMask[ dir ][ 0 ][ 0 ] ;
+		for ( i = 0 ; i < 4 ; i ++ )
+		{
+			int c[2] = { faceProcFaceMask[ dir ][ i ][ 0 ], faceProcFaceMask[ dir ][ i ][ 1 ] };
+			for ( int j = 0 ; j < 2 ; j ++ )
+			{
+				if ( type[j] > 0 )
+				{
+					fcd[j] = node[j] ;
+				}
+				else
+				{
+					fcd[j] = ((InternalNode *) node[ j ] )->child[ c[j] ] ;
+				}
+			}
+
+			nst[0] = st[0] + nlen * ( vertMap[ c[ 0 ] ][ 0 ] - vertMap[ iface ][ 0 ] );
+			nst[1] = st[1] + nlen * ( vertMap[ c[ 0 ] ][ 1 ] - vertMap[ iface ][ 1 ] );
+			nst[2] = st[2] + nlen * ( vertMap[ c[ 0 ] ][ 2 ] - vertMap[ iface ][ 2 ] );
+
+			faceProcContourNoInter2( fcd, nst, nlen, faceProcFaceMask[ dir ][ i ][ 2 ], depth + 1, shared, job ) ;
+		}
+
+
+		// 4 edge calls
+		int orders[2][4] = {{ 0, 0, 1, 1 }, { 0, 1, 0, 1 }} ;
+		OctreeNode* ecd[4] ;
+			
+		for ( i = 0 ; i < 4 ; i ++ )
+		{
+			int c[4] = { faceProcEdgeMask[ dir ][ i ][ 1 ], faceProcEdgeMask[ dir ][ i ][ 2 ],
+						 faceProcEdgeMask[ dir ][ i ][ 3 ], faceProcEdgeMask[ dir ][ i ][ 4 ] };
+			int* order = orders[ faceProcEdgeMask[ dir ][ i ][ 0 ] ] ;
+
+			for ( int j = 0 ; j < 4 ; j ++ )
+			{
+				if ( type[order[j]] > 0 )
+				{
+					ecd[j] = node[order[j]] ;
+				}
+				else
+				{
+					ecd[j] = ( (InternalNode *) node[ order[ j ] ] )->child[ c[j] ] ;
+				}
+			}
+
+			int ndir = faceProcEdgeMask[ dir ][ i ][ 5 ] ;
+			nst[0] = st[0] + nlen ;
+			nst[1] = st[1] + nlen ;
+			nst[2] = st[2] + nlen ;
+			nst[dir] -= nlen ;
+			if ( i % 2 == 0 )
+			{
+				nst[ ndir ] -= nlen ;
+			}
+
+			edgeProcContourNoInter2( ecd, nst, nlen, ndir, depth + 1, shared, job ) ;
+		}
+//		printf("I am done.\n") ;
+	}
+	else
+	{
+//		printf("i don't have children.\n");
+	}
+};
+
+void Octree::edgeProcContourNoInter2( OctreeNode* node[4], int st[3], int len, int dir, int depth, NoInterShared& shared, NoInterJob& job )
+{
+//	printf("I am at an edge! %d %d %d \n", st[0], st[1], st[2] ) ;
+	if ( ! ( node[0] && node[1] && node[2] && node[3] ) )
+	{
+//		printf("I am done!\n") ;
+		return ;
+	}
+
+	int type[4] = { node[0]->getType(), node[1]->getType(), node[2]->getType(), node[3]->getType() } ;
+
+	if ( type[0] > 0 && type[1] > 0 && type[2] > 0 && type[3] > 0 )
+	{
+		if ( job.plan != NULL )
+		{
+			addJob( *job.plan, ContourJob::EDGE, node, 4, dir, st, len ) ;
+			return ;
+		}
+		this->processEdgeNoInter2( node, st, len, dir, shared, job ) ;
+	}
+	else
+	{
+		if ( job.plan != NULL && depth >= opts.contourDepth )
+		{
+			addJob( *job.plan, ContourJob::EDGE, node, 4, dir, st, len ) ;
+			return ;
+		}
+		int i, j ;
+		int nlen = len / 2 ;
+		int nst[3] ;
+
+		// 2 edge calls
+		OctreeNode* ecd[4] ;
+		for ( i = 0 ; i < 2 ; i ++ )
+		{
+			int c[ 4 ] = { edgeProcEdgeMask[ dir ][ i ][ 0 ], 
+						   edgeProcEdgeMask[ dir ][ i ][ 1 ], 
+						   edgeProcEdgeMask[ dir ][ i ][ 2 ], 
+						   edgeProcEdgeMask[ dir ][ i ][ 3 ] } ;
+
+			for ( int j = 0 ; j < 4 ; j ++ )
+			{
+				if ( type[j] > 0 )
+				{
+					ecd[j] = node[j] ;
+				}
+				else
+				{
+					ecd[j] = ((InternalNode *) node[j])->child[ c[j] ] ;
+				}
+			}
+
+			nst[0] = st[0] ;
+			nst[1] = st[1] ;
+			nst[2] = st[2] ;
+			nst[dir] += nlen * i ;
+
+			edgeProcContourNoInter2( ecd, nst, nlen, edgeProcEdgeMask[ dir ][ i ][ 4 ], depth + 1, shared, job ) ;
+		}
+
+	}
+//		printf("I am done!\n") ;
+};
+
+
+void Octree::processEdgeNoInter2( OctreeNode* node[4], int st[3], int len, int dir, NoInterShared& shared, NoInterJob& job )
+{
+//	printf("I am at a leaf edge! %d %d %d\n", st[0], st[1], st[2] ) ;
+	// Get minimal cell
+	int i, type, minht = maxDepth+1, mini = -1 ;
+	int ind[4], sc[4], ht[4], flip=0;
+	float mp[4][3] ;
+	for ( i = 0 ; i < 4 ; i ++ ) {
+		if ( node[i]->getType() == LEAF ) {
+			LeafNode* lnode = ((LeafNode *) node[i]) ;
+			ht[i] = lnode->height ;
+			mp[i][0] = lnode->mp[0] ;
+			mp[i][1] = lnode->mp[1] ;
+			mp[i][2] = lnode->mp[2] ;
+
+
+			int ed = processEdgeMask[dir][i] ;
+			int c1 = edgevmap[ed][0] ;
+			int c2 = edgevmap[ed][1] ;
+
+			if ( lnode->height < minht ) {
+				minht = lnode->height ;
+				mini = i ;
+				if ( lnode->getSign(c1) > 0 )
+					flip = 1 ;
+				else
+					flip = 0 ;
+			}
+			ind[i] = lnode->index ; // leaf number, see genMeshNoInter2()
+			touchLeaf( shared, job, ind[i] ) ;
+
+			if ( lnode->getSign( c1 ) == lnode->getSign( c2 ) )
+				sc[ i ] = 0 ;
+			else
+				sc[ i ] = 1 ;
+		}
+		else if ( node[i]->getType() == PSEUDOLEAF ) {
+			PseudoLeafNode* pnode = ((PseudoLeafNode *) node[i]) ;
+			ht[i] = pnode->height ;
+			mp[i][0] = pnode->mp[0] ;
+			mp[i][1] = pnode->mp[1] ;
+			mp[i][2] = pnode->mp[2] ;
+
+			int ed = processEdgeMask[dir][i] ;
+			int c1 = edgevmap[ed][0] ;
+			int c2 = edgevmap[ed][1] ;
+
+			if ( pnode->height < minht )
+			{
+				minht = pnode->height ;
+				mini = i ;
+				if ( pnode->getSign(c1) > 0 )
+					flip = 1 ;
+				else
+					flip = 0 ;
+
+			}
+			ind[i] = pnode->index ; // leaf number, see genMeshNoInter2()
+			touchLeaf( shared, job, ind[i] ) ;
+
+			if ( pnode->getSign( c1 ) == pnode->getSign( c2 ) )
+				sc[ i ] = 0 ;
+			else
+				sc[ i ] = 1 ;
+		}
+		else {
+			printf("Wrong!\n");
+		}
+
+	}
+
+	if ( sc[ mini ] == 0 )
+	{
+//		printf("I am done!\n" ) ;
+		return ;
+	}
+
+	/************************************************************************/
+	/* Performing test                                                      */
+	/************************************************************************/
+
+	int fverts[4] ;
+	int hasFverts[4] = { 0, 0, 0, 0 } ;
+	int evert ;
+	int needTess = 0 ;
+	
+	
+
+	// First, face test
+	int nbr[4][2] = { {0,1},{1,3},{2,3},{0,2} };
+	int fdir[3][4] = {
+		{2,1,2,1},
+		{0,2,0,2},
+		{1,0,1,0}};
+	int dir3[3][4][2] = {
+		{{1, -1},{2, 0},{1, 0},{2, -1}},
+		{{2, -1},{0, 0},{2, 0},{0, -1}},
+		{{0, -1},{1, 0},{0, 0},{1, -1}} };
+
+	for ( i = 0 ; i < 4 ; i ++ )
+	{
+		int a = nbr[i][0];
+		int b = nbr[i][1] ;
+
+#ifndef TESS_UNIFORM
+		if ( ht[a] != ht[b] )
+#endif
+		{
+			// Different level, check if the dual edge passes through the face
+			int sht = ( ht[a] > ht[b] ? ht[b] : ht[a] ) ;
+			int flen = ( 1 << sht ) ;
+			int fst[3] ;
+
+			fst[ fdir[dir][i] ] = st[ fdir[dir][i] ] ;
+			fst[ dir3[dir][i][0] ] = st[ dir3[dir][i][0] ] + flen * dir3[dir][i][1] ;
+			fst[ dir ] = st[ dir ] - ( st[ dir ] & (( 1 << sht ) - 1 ) ) ;
+
+			// If not found, test it here: when the dual edge does not pass
+			// the face, a new vertex is made, placed once the edge vertex is known
+			int found = shared.faces.findOrAdd( node[a], node[b], fverts[i], [&]( ) {
+				return testFace( fst, flen, fdir[dir][i], mp[a], mp[b] ) == 0 ; } ) ;
+			if ( found )
+			{
+				if ( found == 1 )
+					job.founds ++ ;
+				else
+					job.news ++ ;
+				fverts[i] |= NoInterJob::FACE ;
+				job.events.push_back( fverts[i] ) ;
+				hasFverts[i] = 1 ;
+				needTess = 1 ;
+			}
+		}
+	}
+
+	// Next, edge test
+	int diag = 1 ;
+	if ( needTess == 0 )
+	{
+		// Even if all dual edges pass through faces, the dual complex of an edge may not be convex
+		//int st2[3] = { st[0], st[1], st[2] } ;
+		//st2[ dir ] += len ;
+
+		diag = testEdge( st, len, dir, node, mp ) ;
+		if ( diag == 0 )
+		{
+			// When this happens, we need to create an extra vertex on the primal edge
+			needTess = 1 ;
+		}
+	}
+
+	float cent[3] ;
+	if ( needTess )
+	{
+		job.edgeVerts ++ ;
+		makeEdgeVertex( st, len, dir, node, mp, cent ) ;
+
+		/* Just take centroid
+		int num = 0 ;
+		evert[0] = st[0] ;
+		evert[1] = st[1] ;
+		evert[2] = st[2] ;
+		evert[dir] = 0 ;
+		for ( i = 0 ; i < 4 ; i ++ )
+		{
+			evert[dir] += mp[i][dir] ;
+			num ++ ;
+
+			if ( hasFverts[ i ] )
+			{
+				evert[dir] += fverts[i][dir] ;
+				num ++ ;
+			}
+		}
+		evert[dir] /= num ;
+		*/
+
+/*
+		if ( evert[dir] < st[dir] )
+		{
+			evert[dir] = st[dir] ;
+		}
+		else if ( evert[dir] > st[dir] + len )
+		{
+			evert[dir] = st[dir] + len ;
+		}
+*/		
+
+		evert = NoInterJob::EDGE | (unsigned int) ( job.edgePos.size( ) / 3 ) ;
+		job.edgePos.insert( job.edgePos.end( ), cent, cent + 3 ) ;
+		job.events.push_back( evert ) ;
+
+	}
+
+	int flipped[3];
+	if ( flip == 0 )
+	{
+		for (i = 0 ;i < 3 ; i ++)
+		{
+			flipped[i] = i ;
+		}
+	}
+	else
+	{
+		for (i = 0 ;i < 3 ; i ++)
+		{
+			flipped[i] = 2 - i ;
+		}
+	}
+
+
+
+	// Finally, let's output triangle
+	if ( needTess == 0 )
+	{
+		// Normal splitting of quad
+		if ( diag == 1 )
+		{
+			if ( node[0] != node[1] && node[1] != node[3] )
+			{
+				int tind1[]={0,1,3} ;
+				
+				int t1[3] ;
+				for ( int j = 0 ; j < 3 ; j ++ )
+				{
+					t1[flipped[j]] = ind[ tind1[j] ] ;
+				}
+				addTriangle( job.tris, t1 ) ;
+			}
+			
+			if ( node[3] != node[2] && node[2] != node[0] )
+			{
+				int tind2[]={3,2,0} ;
+				
+				int t2[3] ;
+				for ( int j = 0 ; j < 3 ; j ++ )
+				{
+					t2[flipped[j]] = ind[ tind2[j] ] ;
+				}
+				addTriangle( job.tris, t2 ) ;
+			}
+		}
+		else
+		{
+			if ( node[0] != node[1] && node[1] != node[2] )
+			{
+				int tind1[]={0,1,2} ;
+				
+				
+				int t1[3] ;
+				for ( int j = 0 ; j < 3 ; j ++ )
+				{
+					t1[flipped[j]] = ind[ tind1[j] ] ;
+				}
+				addTriangle( job.tris, t1 ) ;
+			}
+			
+			if ( node[1] != node[3] && node[3] != node[2] )
+			{
+				int tind2[]={1,3,2} ;
+				
+				int t2[3] ;
+				for ( int j = 0 ; j < 3 ; j ++ )
+				{
+					t2[flipped[j]] = ind[ tind2[j] ] ;
+				}
+				addTriangle( job.tris, t2 ) ;
+			}
+		}
+		
+	}
+	
+	else
+	{/*
+		if ( flip == 1 )
+		{
+			int tempind[4]={ind[0], ind[2], ind[1], ind[3]};
+			OctreeNode* tempnode[4] = {node[0], node[2], node[1], node[3]};
+			int tempfverts[4]={fverts[3], fverts[2], fverts[1], fverts[0]};
+			int temphasFverts[4]={hasFverts[3], hasFverts[2], hasFverts[1], hasFverts[0]};
+			int templocation[4]={location[3], location[2], location[1], location[0]};
+			int tempnvert[4]={nvert[3], nvert[2], nvert[1], nvert[0]};
+
+			for ( i = 0 ; i < 4 ; i ++ )
+			{
+				ind[i] = tempind[i] ;
+				node[i] = tempnode[i] ;
+				fverts[i] = tempfverts[i] ;
+				hasFverts[i] = temphasFverts[i] ;
+				location[i] = templocation[i] ;
+				nvert[i] = tempnvert[i] ;
+			}
+		}	
+		*/
+		int nnbr[4][2] = { {0,1},{1,3},{3,2},{2,0} };
+
+		// Center-splitting
+		for ( i = 0 ; i < 4 ; i ++ )
+		{
+			int a = nnbr[i][0];
+			int b = nnbr[i][1] ;
+
+			if ( hasFverts[ i ] )
+			{
+				// Further split each triangle into two
+				int t[3] ;
+					t[flipped[0]] = ind[ a ] ;
+					t[flipped[1]] = fverts[ i ] ;
+					t[flipped[2]] = evert ;
+				addTriangle( job.tris, t ) ;
+
+					t[flipped[0]] = evert ;
+					t[flipped[1]] = fverts[ i ] ;
+					t[flipped[2]] = ind[ b ] ;
+				addTriangle( job.tris, t ) ;
+
+				// Update geometric location of the face vertex when merging
+				job.faceMoves.push_back( fverts[i] ) ;
+				job.faceCents.insert( job.faceCents.end( ), cent, cent + 3 ) ;
+			}
+			else
+			{
+				// For one triangle with center vertex
+				if ( node[a] != node[b] )
+				{
+					int t[3] ;
+						t[flipped[0]] = ind[ a ] ;
+						t[flipped[1]] = ind[ b ] ;
+						t[flipped[2]] = evert ;
+					addTriangle( job.tris, t ) ;
+				}
+			}
+		}
+	}
+//		printf("I am done!\n" ) ;
+	
+};
@@ -1,396 +1,628 @@
-/*
-
-  Main class and structures for DC
-
-  Copyright (C) 2011  Tao Ju
-
-  This library is free software; you can redistribute it and/or
-  modify it under the terms of the GNU Lesser General Public License
-  (LGPL) as published by the Free Software Foundation; either
-  version 2.1 of the License, or (at your option) any later version.
-
-  This library is distributed in the hope that it will be useful,
-  but WITHOUT ANY WARRANTY; without even the implied warranty of
-  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
-  Lesser General Public License for more details.
-
-  You should have received a copy of the GNU Lesser General Public
-  License along with this library; if not, write to the Free Software
-  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
-*/
-
-#ifndef OCTREE_H
-#define OCTREE_H
-
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include <math.h>
-#include <time.h>
-#include "GeoCommon.hpp"
-#include "eigen.hpp"
-#include "HashMap.hpp"
-#include "intersection.hpp"
-
-// Clamp all minimizers to be inside the cell
-//#define CLAMP
-
-// If SOG vertices are relative to each cell
-//#define SOG_RELATIVE
-
-//#define EDGE_TEST_CONVEXITY
-//#define EDGE_TEST_FLIPDIAGONAL
-#define EDGE_TEST_NEW
-
-//#define TESS_UNIFORM
-//#define TESS_NONE
-
-// old definiton was: 0== InternalNode, 1== LeafNode, 2==PseudoLeafNode
-enum NodeType { INTERNAL, LEAF, PSEUDOLEAF };
-
-/* Tree nodes */
-class OctreeNode {
-public:
-    OctreeNode(){};
-    virtual NodeType getType() = 0; // 0== InternalNode, 1== LeafNode, 2==PseudoLeafNode
-};
-
-class InternalNode : public OctreeNode {
-public: // no signs, height, len, or QEF stored for internal node
-	OctreeNode * child[8] ;
-	InternalNode ()  {
-		for ( int i = 0 ; i < 8 ; i ++ )
-			child[i] = NULL ;
-	};
-	~InternalNode() {
-		for ( int i = 0 ; i < 8 ; i ++ ) {
-			if (child[i] != NULL) {
-				delete child[i];
-			}
-		}
-	}
-	NodeType getType ( ) { return INTERNAL; };
-};
-
-class QEFMixin {
-protected:
-	unsigned char signs;
-public:
-	char height; // depth
-	float mp[3]; // this is the minimizer point of the QEF
-	int index; // vertex index in PLY file
-	float ata[6], atb[3], btb; // QEF data
-	
-	void clearQEF() {
-		for ( int i = 0 ; i < 6 ; i ++ )
-			ata[i] = 0 ;
-
-		for ( int i = 0 ; i < 3 ; i ++ ) {
-			mp[i] = 0;
-			atb[i] = 0 ;
-		}
-
-		btb = 0 ;
-	}
-	void setQEF(float ata1[6], float atb1[3], float btb1, float mp1[3] ) {
-		for ( int i = 0 ; i < 6 ; i ++ )
-			ata[i] = ata1[i] ;
-
-		for ( int i = 0 ; i < 3 ; i ++ ) {
-			mp[i] = mp1[i] ;
-			atb[i] = atb1[i] ;
-		}
-		btb = btb1 ;
-	}
-	int getSign ( int index ) { return (( signs >> index ) & 1 ); };
-};
-
-class LeafNode : public OctreeNode, public QEFMixin {
-
-public:
-	~LeafNode() {};
-	
-	// Construction
-	LeafNode( int ht, unsigned char sg, float coord[3] )  {
-		height = ht ;
-		signs = sg ;
-		clearQEF();
-		index = -1 ;
-	};
-
-	// Construction by QEF
-	// each edge of the cube can have an intersection point
-	// so we can give up to 12 intersection points with 12 normal-vectors
-	// specify number of intersections in numint
-	//
-	// st is the minimum bounding-box point
-	// st + (1,1,1)*len is the maximum bounding-box point
-	LeafNode( int ht, unsigned char sg, int st[3], int len, int numint, float inters[12][3], float norms[12][3] ) {
-		height = ht;
-		signs = sg;
-		index = -1;
-		clearQEF();
-		
-		float pt[3] ={0,0,0} ;
-		if ( numint > 0 ) {
-			for ( int i = 0 ; i < numint ; i ++ ) {
-				float* norm = norms[i] ;
-				float* p = inters[i] ;
-				// printf("Norm: %f, %f, %f Pts: %f, %f, %f\n", norm[0], norm[1], norm[2], p[0], p[1], p[2] ) ;
-
-				// QEF
-				ata[ 0 ] += (float) ( norm[ 0 ] * norm[ 0 ] );
-				ata[ 1 ] += (float) ( norm[ 0 ] * norm[ 1 ] );
-				ata[ 2 ] += (float) ( norm[ 0 ] * norm[ 2 ] );
-				ata[ 3 ] += (float) ( norm[ 1 ] * norm[ 1 ] );
-				ata[ 4 ] += (float) ( norm[ 1 ] * norm[ 2 ] );
-				ata[ 5 ] += (float) ( norm[ 2 ] * norm[ 2 ] );
-				double pn = p[0] * norm[0] + p[1] * norm[1] + p[2] * norm[2] ;
-				atb[ 0 ] += (float) ( norm[ 0 ] * pn ) ;
-				atb[ 1 ] += (float) ( norm[ 1 ] * pn ) ;
-				atb[ 2 ] += (float) ( norm[ 2 ] * pn ) ;
-				btb += (float) pn * (float) pn ;
-				// Minimizer
-				pt[0] += p[0] ;
-				pt[1] += p[1] ;
-				pt[2] += p[2] ;
-			}
-			// we minimize towards the average of all intersection points
-			pt[0] /= numint ;
-			pt[1] /= numint ;
-			pt[2] /= numint ;
-			// Solve
-			float mat[10] ;
-			BoundingBoxf * box = new BoundingBoxf();
-			box->begin.x = (float) st[0] ;
-			box->begin.y = (float) st[1] ;
-			box->begin.z = (float) st[2] ;
-			box->end.x = (float) st[0] + len ;
-			box->end.y = (float) st[1] + len ;
-			box->end.z = (float) st[2] + len ;
-			
-			// eigen.hpp
-			// calculate minimizer point, and return error
-			// QEF: ata, atb, btb
-			// pt is the average of the intersection points
-			// mp is the result
-			// box is a bounding-box for this node
-			// mat is storage for calcPoint() ?
-			float error = calcPoint( ata, atb, btb, pt, mp, box, mat ) ;
-
-#ifdef CLAMP // Clamp all minimizers to be inside the cell
-			if ( mp[0] < st[0] || mp[1] < st[1] || mp[2] < st[2] || // mp is outside bounding-box min-pt
-				mp[0] > st[0] + len || mp[1] > st[1] + len || mp[2] > st[2] + len ) // mp is outside bounding-box max-pt
-			{
-				mp[0] = pt[0] ; // reject mp by calcPoint, instead clamp solution to the mass-center
-				mp[1] = pt[1] ;
-				mp[2] = pt[2] ;
-			}
-#endif
-		}
-		else {
-			printf("Number of edge intersections in this leaf cell is zero!\n") ;
-			mp[0] = st[0] + len / 2;
-			mp[1] = st[1] + len / 2;
-			mp[2] = st[2] + len / 2;
-		}
-	};
-
-	NodeType getType ( ) { return LEAF ; };
-};
-
-// leaf, but not at max depth
-// created by merging child-nodes
-class PseudoLeafNode : public OctreeNode, public QEFMixin {
-public:
-	OctreeNode * child[8] ; // Children 
-	
-	~PseudoLeafNode() {
-		for ( int i = 0 ; i < 8 ; i ++ ) {
-			if (child[i] != NULL)
-				delete child[i];
-		}
-	}
-	
-	// Construction, without QEF
-	PseudoLeafNode ( int ht, unsigned char sg, float coord[3] )  {
-		height = ht;
-		signs = sg;
-		clearQEF();
-		for ( int i = 0 ; i < 3 ; i ++ ) 
-			mp[i] = coord[i] ;
-
-		for ( int i = 0 ; i < 8 ; i ++ ) 
-			child[i] = NULL ;
-
-		index = -1 ;
-	};
-
-	// construction with QEF
-	PseudoLeafNode ( int ht, unsigned char sg, float ata1[6], float atb1[3], float btb1, float mp1[3] )  {
-		height = ht ;
-		signs = sg ;
-		setQEF(ata1, atb1, btb1, mp1);
-		for ( int i = 0 ; i < 8 ; i ++ )
-			child[i] = NULL ;
-
-		index = -1 ;
-	};
-	NodeType getType ( ) { return PSEUDOLEAF ; };
-};
-
-
-/* Global variables */
-
-// map from the 12 edges of the cube to the 8 vertices.
-// example: edge 0 connects vertices 0,4
-const int edgevmap[12][2] = {{0,4},{1,5},{2,6},{3,7},{0,2},{1,3},{4,6},{5,7},{0,1},{2,3},{4,5},{6,7}};
-const int edgemask[3] = { 5, 3, 6 } ;
-
-// direction from parent st to each of the eight child st
-// st is the corner of the cube with minimum (x,y,z) coordinates
-const int vertMap[8][3] = {{0,0,0},{0,0,1},{0,1,0},{0,1,1},{1,0,0},{1,0,1},{1,1,0},{1,1,1}} ;
-
-// map from the 6 faces of the cube to the 4 vertices that bound the face
-const int faceMap[6][4] = {{4, 8, 5, 9}, {6, 10, 7, 11},{0, 8, 1, 10},{2, 9, 3, 11},{0, 4, 2, 6},{1, 5, 3, 7}} ;
-
-// first used by cellProcCount()
-// used in cellProcContour(). 
-// between 8 child-nodes there are 12 faces.
-// first two numbers are child-pairs, to be processed by faceProcContour()
-// the last number is "dir" ?
-const int cellProcFaceMask[12][3] = {{0,4,0},{1,5,0},{2,6,0},{3,7,0},{0,2,1},{4,6,1},{1,3,1},{5,7,1},{0,1,2},{2,3,2},{4,5,2},{6,7,2}} ;
-
-
-// then used in cellProcContour() when calling edgeProc()
-// between 8 children there are 6 common edges
-// table lists the 4 children that share the edge
-// the last number is "dir" ?
-const int cellProcEdgeMask[6][5] = {{0,1,2,3,0},{4,5,6,7,0},{0,4,1,5,1},{2,6,3,7,1},{0,2,4,6,2},{1,3,5,7,2}} ;
-
-// usde by faceProcCount()
-const int faceProcFaceMask[3][4][3] = {
-	{{4,0,0},{5,1,0},{6,2,0},{7,3,0}},
-	{{2,0,1},{6,4,1},{3,1,1},{7,5,1}},
-	{{1,0,2},{3,2,2},{5,4,2},{7,6,2}}
-} ;
-const int faceProcEdgeMask[3][4][6] = {
-	{{1,4,0,5,1,1},{1,6,2,7,3,1},{0,4,6,0,2,2},{0,5,7,1,3,2}},
-	{{0,2,3,0,1,0},{0,6,7,4,5,0},{1,2,0,6,4,2},{1,3,1,7,5,2}},
-	{{1,1,0,3,2,0},{1,5,4,7,6,0},{0,1,5,0,4,1},{0,3,7,2,6,1}}
-};
-const int edgeProcEdgeMask[3][2][5] = {
-	{{3,2,1,0,0},{7,6,5,4,0}},
-	{{5,1,4,0,1},{7,3,6,2,1}},
-	{{6,4,2,0,2},{7,5,3,1,2}},
-};
-const int processEdgeMask[3][4] = {{3,2,1,0},{7,5,6,4},{11,10,9,8}} ;
-
-const int dirCell[3][4][3] = {
-	{{0,-1,-1},{0,-1,0},{0,0,-1},{0,0,0}},
-	{{-1,0,-1},{-1,0,0},{0,0,-1},{0,0,0}},
-	{{-1,-1,0},{-1,0,0},{0,-1,0},{0,0,0}}
-};
-const int dirEdge[3][4] = {
-	{3,2,1,0},
-	{7,6,5,4},
-	{11,10,9,8}
-};
-
-
-/**
- * Class for building and processing an octree
- */
-class Octree {
-public:
-	OctreeNode* root ;
-	int dimen; 	   // Length of grid
-	int maxDepth;
-	int hasQEF;    // used in simplify()
-	int faceVerts, edgeVerts;
-	int actualTris ; // number of triangles produced by cellProcContour()
-	int founds, news ;
-public:
-	Octree ( char* fname , double threshold) ;
-	~Octree ( ) ;
-	void simplify ( float thresh ) ;
-	void genContour ( char* fname ) ;
-	//void genContourNoInter ( char* fname ) ; // not called from main() ?
-	void genContourNoInter2 ( char* fname ) ;
-	
-	void countNodes(int result[3]) {
-		for (int i=0;i<3;i++)
-			result[i]=0;
-		countNodes(this->root, result);
-	}
-	
-	void countNodes( OctreeNode* node, int result[3] ) {
-		switch( node->getType() ) {
-			case INTERNAL:
-				result[0]++;
-				InternalNode* inode;
-				inode = (InternalNode*)node;
-				for (int i=0;i<8;i++) {
-					if (inode->child[i]!=NULL)
-						countNodes( inode->child[i], result);
-				}
-				break;
-			case PSEUDOLEAF:
-				result[1]++;
-				PseudoLeafNode* pnode;
-				pnode = (PseudoLeafNode*)node;
-				for (int i=0;i<8;i++) {
-					if (pnode->child[i]!=NULL)
-						countNodes( pnode->child[i], result);
-				}
-				break;
-			case LEAF:
-				result[2]++;
-				break;
-		}
-	}
-private:
-	float simplify_threshold;
-	OctreeNode* simplify( OctreeNode* node, int st[3], int len, float thresh ) ;
-
-	//void readSOG ( char* fname ) ; // read SOG file
-	//OctreeNode* readSOG ( FILE* fin, int st[3], int len, int ht, float origin[3], float range ) ;
-	void readDCF ( char* fname ) ; // read DCF file
-	OctreeNode* readDCF ( FILE* fin, int st[3], int len, int ht ) ;
-
-// Contouring
-	void generateVertexIndex( OctreeNode* node, int& offset, FILE* fout ) ; // not used by NoInter2-functions?
-
-	void cellProcContour ( OctreeNode* node, FILE* fout ) ;
-	void faceProcContour ( OctreeNode* node[2], int dir, FILE* fout ) ;
-	void edgeProcContour ( OctreeNode* node[4], int dir, FILE* fout ) ;
-	void processEdgeWrite ( OctreeNode* node[4], int dir, FILE* fout ) ;
-	void cellProcCount ( OctreeNode* node, int& nverts, int& nfaces ) ;
-	void faceProcCount ( OctreeNode* node[2], int dir, int& nverts, int& nfaces ) ;
-	void edgeProcCount ( OctreeNode* node[4], int dir, int& nverts, int& nfaces ) ;
-	void processEdgeCount ( OctreeNode* node[4], int dir, int& nverts, int& nfaces ) ;
-
-/* not used !?
-	void cellProcContourNoInter( OctreeNode* node, int st[3], int len, HashMap2* hash, TriangleList* list, int& numTris ) ;
-	void faceProcContourNoInter( OctreeNode* node[2], int st[3], int len, int dir, HashMap2* hash, TriangleList* list, int& numTris ) ;
-	void edgeProcContourNoInter( OctreeNode* node[4], int st[3], int len, int dir, HashMap2* hash, TriangleList* list, int& numTris ) ;
-	void processEdgeNoInter( OctreeNode* node[4], int st[3], int len, int dir, HashMap2* hash, TriangleList* list, int& numTris ) ;
-*/
-
-	void cellProcContourNoInter2( OctreeNode* node, int st[3], int len, HashMap* hash, IndexedTriangleList* tlist, int& numTris, VertexList* vlist, int& numVerts ) ;
-	void faceProcContourNoInter2( OctreeNode* node[2], int st[3], int len, int dir, HashMap* hash, IndexedTriangleList* tlist, int& numTris, VertexList* vlist, int& numVerts ) ;
-	void edgeProcContourNoInter2( OctreeNode* node[4], int st[3], int len, int dir, HashMap* hash, IndexedTriangleList* tlist, int& numTris, VertexList* vlist, int& numVerts ) ;
-	void processEdgeNoInter2( OctreeNode* node[4], int st[3], int len, int dir, HashMap* hash, IndexedTriangleList* tlist, int& numTris, VertexList* vlist, int& numVerts ) ;
-
-	/**
-	 *  Non-intersecting test and tesselation
-	 */
-	int testFace( int st[3], int len, int dir, float v1[3], float v2[3] ) ;
-	int testEdge( int st[3], int len, int dir, OctreeNode* node[4], float v[4][3] ) ;
-	// not called?
-	// void makeFaceVertex( int st[3], int len, int dir, OctreeNode* node1, OctreeNode* node2, float v[3] ) ;
-	void makeEdgeVertex( int st[3], int len, int dir, OctreeNode* node[4], float mp[4][3], float v[3] ) ;
-};
-
-
-#endif
+/*
+
+  Main class and structures for DC
+
+  Copyright (C) 2011  Tao Ju
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public License
+  (LGPL) as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef OCTREE_H
+#define OCTREE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "GeoCommon.hpp"
+#include "eigen.hpp"
+#include "HashMap.hpp"
+#include "intersection.hpp"
+#include "NodeArena.hpp"
+#include "QEFPool.hpp"
+#include "Mesh.hpp"
+
+#include <vector>
+#include <mutex>
+#include <atomic>
+
+class TaskPool ;
+
+// Clamp all minimizers to be inside the cell
+//#define CLAMP
+
+// If SOG vertices are relative to each cell
+//#define SOG_RELATIVE
+
+//#define EDGE_TEST_CONVEXITY
+//#define EDGE_TEST_FLIPDIAGONAL
+#define EDGE_TEST_NEW
+
+//#define TESS_UNIFORM
+//#define TESS_NONE
+
+// How the DCF file is brought into memory by Octree::readDCF()
+// DCF_FREAD: one fread() per field (original reader)
+// DCF_MMAP:  map the whole file and walk it with a cursor
+// DCF_PARALLEL: map the file, skip-scan it for the subtrees at 
+//               OctreeOptions::splitDepth and decode those on several threads
+enum DCFLoader { DCF_FREAD, DCF_MMAP, DCF_PARALLEL };
+
+// Settings for reading and processing the octree, filled in by dc.cpp
+struct OctreeOptions {
+	DCFLoader loader ; // how the DCF file is read
+	int numThreads ;   // worker threads, 0 = one per core
+	int splitDepth ;   // depth of the subtrees that DCF_PARALLEL decodes as separate tasks
+
+	// DCF2 input only: which subtrees of the index table are loaded.
+	// Entries listed in subtrees are loaded with everything below them,
+	// if hasRegion is set only subtrees whose leaves touch region are loaded.
+	// Everything is loaded when neither is given.
+	std::vector<int> subtrees ;
+	int hasRegion ;
+	int region[6] ;    // min x,y,z and max x,y,z in grid units
+
+	int recycleNodes ; // simplify() hands nodes it removes back to the arena for reuse
+	int batchQEF ;     // leaf minimizers are solved in batches by calcPointBatch() instead of one calcPoint() each
+	QEFSolver qefSolver ; // how calcPoint() places minimizers, batches are only used for QEF_PSEUDO_INVERSE
+	int lazyQEF ;      // leaves keep their mass point until simplify() is done, only the leaves left are solved
+	int simplifyGrain ; // simplify() runs the children of nodes at least this many cells wide as separate tasks
+	int streamSimplify ; // the reader collapses each internal node as soon as its children are read, implies lazyQEF
+	int singlePass ;   // genMesh() grows the mesh arrays as it goes instead of counting with cellProcCount() first
+	int contourDepth ; // genMesh() splits the traversal into jobs this many levels below the root, 0 = serial
+	int littleEndianPLY ; // write binary_little_endian PLY files instead of big endian
+
+	OctreeOptions( ) {
+		loader = DCF_FREAD ;
+		numThreads = 0 ;
+		splitDepth = 2 ;
+		hasRegion = 0 ;
+		recycleNodes = 1 ;
+		batchQEF = 1 ;
+		qefSolver = QEF_PSEUDO_INVERSE ;
+		lazyQEF = 0 ;
+		simplifyGrain = 16 ;
+		streamSimplify = 0 ;
+		singlePass = 0 ;
+		contourDepth = 3 ;
+		littleEndianPLY = 0 ;
+	};
+};
+
+// Indexed DCF ("DCF2") file layout:
+//   char[10]  "dcf2index"
+//   int       dimen
+//   int       index depth
+//   int       number of table entries
+//   DCF2Entry table[], every node down to the index depth, in preorder
+//   the node stream of the DCF file ("multisign" body), unchanged
+// Each table entry points at its node in the stream, so any subtree can
+// be decoded on its own without touching the rest of the file.
+struct DCF2Entry {
+	long long offset ;     // byte offset of the node from the start of the file
+	int st[3], len ;       // cell of the node
+	int depth, type ;      // depth below the root, DCF node type (0 internal, 1 empty, 2 leaf)
+	int nodeCount ;        // internal and leaf nodes in the subtree, including this one
+	int leafCount ;        // leaf nodes in the subtree
+	int bmin[3], bmax[3] ; // bounding box of the leaf cells, only valid if leafCount > 0
+};
+
+// old definiton was: 0== InternalNode, 1== LeafNode, 2==PseudoLeafNode
+enum NodeType { INTERNAL, LEAF, PSEUDOLEAF };
+
+/* Tree nodes
+ * All nodes live in the NodeArenas of their Octree and are freed together
+ * with it, so they are never deleted one by one and do not delete their children.
+ * There is no vtable: the node type is a tag in the first byte, so the
+ * contouring recursion reads it inline instead of through a virtual call.
+ */
+class OctreeNode {
+public:
+	unsigned char type ; // NodeType
+	NodeType getType() { return (NodeType) type ; } ; // 0== InternalNode, 1== LeafNode, 2==PseudoLeafNode
+protected:
+	OctreeNode( NodeType t ) { type = t ; } ;
+};
+
+class InternalNode : public OctreeNode {
+public: // no signs, height, len, or QEF stored for internal node
+	int collapse ; // entry in the collapse-error tree of the Octree, -1 if there is none
+	OctreeNode * child[8] ;
+	InternalNode () : OctreeNode( INTERNAL ) {
+		collapse = -1 ;
+		for ( int i = 0 ; i < 8 ; i ++ )
+			child[i] = NULL ;
+	};
+};
+
+// Fields shared by LeafNode and PseudoLeafNode, packed to 24 bytes:
+// type, signs, height and solved share the first word, then index, mp and the QEF handle
+class QEFMixin : public OctreeNode {
+protected:
+	unsigned char signs;
+	QEFMixin( NodeType t ) : OctreeNode( t ) { solved = 1 ; } ;
+public:
+	char height; // depth
+	unsigned char solved; // 0 while mp is still the mass point of a leaf read with OctreeOptions::lazyQEF
+	int index; // vertex index in PLY file
+	float mp[3]; // this is the minimizer point of the QEF
+	unsigned int qef; // QEF data in the QEFPool of the Octree, QEFPool::NONE if there is none
+	
+	void clearQEF( ) {
+		for ( int i = 0 ; i < 3 ; i ++ )
+			mp[i] = 0;
+		qef = QEFPool::NONE ;
+	}
+	void setQEF( unsigned int q, float mp1[3] ) {
+		for ( int i = 0 ; i < 3 ; i ++ )
+			mp[i] = mp1[i] ;
+		qef = q ;
+	}
+	int getSign ( int index ) { return (( signs >> index ) & 1 ); };
+	unsigned char getSigns ( ) { return signs; };
+};
+
+class LeafNode : public QEFMixin {
+
+public:
+	// Construction, with the minimizer at coord
+	LeafNode( int ht, unsigned char sg, float coord[3] ) : QEFMixin( LEAF ) {
+		height = ht ;
+		signs = sg ;
+		setQEF( QEFPool::NONE, coord );
+		index = -1 ;
+	};
+
+	// Construction by QEF
+	// each edge of the cube can have an intersection point
+	// so we can give up to 12 intersection points with 12 normal-vectors
+	// specify number of intersections in numint
+	//
+	// st is the minimum bounding-box point
+	// st + (1,1,1)*len is the maximum bounding-box point
+	// the QEF is accumulated into q, which starts out cleared,
+	// the caller puts it in the QEFPool and sets qef
+	// solver is the calcPoint() method for the minimizer
+	LeafNode( int ht, unsigned char sg, int st[3], int len, int numint, float inters[12][3], float norms[12][3], QEFData& q,
+		QEFSolver solver ) : QEFMixin( LEAF ) {
+		height = ht;
+		signs = sg;
+		index = -1;
+		clearQEF( );
+		
+		float pt[3] ={0,0,0} ;
+		if ( numint > 0 ) {
+			accumulateQEF( numint, inters, norms, q, pt ) ;
+			solve( st, len, q, pt, solver ) ;
+		}
+		else {
+			printf("Number of edge intersections in this leaf cell is zero!\n") ;
+			mp[0] = st[0] + len / 2;
+			mp[1] = st[1] + len / 2;
+			mp[2] = st[2] + len / 2;
+		}
+	};
+
+	// place mp at the minimizer of q, for the cell at st of size len
+	// pt is the average of the intersection points
+	void solve( int st[3], int len, QEFData& q, float pt[3], QEFSolver solver ) {
+		float mat[10] ;
+		BoundingBoxf box ;
+		box.begin.x = (float) st[0] ;
+		box.begin.y = (float) st[1] ;
+		box.begin.z = (float) st[2] ;
+		box.end.x = (float) st[0] + len ;
+		box.end.y = (float) st[1] + len ;
+		box.end.z = (float) st[2] + len ;
+		
+		// eigen.hpp
+		// calculate minimizer point, and return error
+		// QEF: ata, atb, btb
+		// pt is the average of the intersection points
+		// mp is the result
+		// box is a bounding-box for this node
+		// mat is storage for calcPoint() ?
+		float error = calcPoint( q.ata, q.atb, q.btb, pt, mp, &box, mat, solver ) ;
+
+#ifdef CLAMP // Clamp all minimizers to be inside the cell
+		clampToCell( st, len, pt ) ;
+#endif
+		solved = 1 ;
+	};
+
+	// add the QEF of numint intersection points and normals to q,
+	// pt is set to the average of the points
+	static void accumulateQEF( int numint, float inters[12][3], float norms[12][3], QEFData& q, float pt[3] ) {
+		float* ata = q.ata ;
+		float* atb = q.atb ;
+		float& btb = q.btb ;
+		pt[0] = pt[1] = pt[2] = 0 ;
+		for ( int i = 0 ; i < numint ; i ++ ) {
+			float* norm = norms[i] ;
+			float* p = inters[i] ;
+			// printf("Norm: %f, %f, %f Pts: %f, %f, %f\n", norm[0], norm[1], norm[2], p[0], p[1], p[2] ) ;
+
+			// QEF
+			ata[ 0 ] += (float) ( norm[ 0 ] * norm[ 0 ] );
+			ata[ 1 ] += (float) ( norm[ 0 ] * norm[ 1 ] );
+			ata[ 2 ] += (float) ( norm[ 0 ] * norm[ 2 ] );
+			ata[ 3 ] += (float) ( norm[ 1 ] * norm[ 1 ] );
+			ata[ 4 ] += (float) ( norm[ 1 ] * norm[ 2 ] );
+			ata[ 5 ] += (float) ( norm[ 2 ] * norm[ 2 ] );
+			double pn = p[0] * norm[0] + p[1] * norm[1] + p[2] * norm[2] ;
+			atb[ 0 ] += (float) ( norm[ 0 ] * pn ) ;
+			atb[ 1 ] += (float) ( norm[ 1 ] * pn ) ;
+			atb[ 2 ] += (float) ( norm[ 2 ] * pn ) ;
+			btb += (float) pn * (float) pn ;
+			// Minimizer
+			pt[0] += p[0] ;
+			pt[1] += p[1] ;
+			pt[2] += p[2] ;
+		}
+		// we minimize towards the average of all intersection points
+		pt[0] /= numint ;
+		pt[1] /= numint ;
+		pt[2] /= numint ;
+	};
+
+	// if mp is outside the cell, reject it and use the mass-center pt instead
+	void clampToCell( int st[3], int len, float pt[3] ) {
+		if ( mp[0] < st[0] || mp[1] < st[1] || mp[2] < st[2] || // mp is outside bounding-box min-pt
+			mp[0] > st[0] + len || mp[1] > st[1] + len || mp[2] > st[2] + len ) // mp is outside bounding-box max-pt
+		{
+			mp[0] = pt[0] ;
+			mp[1] = pt[1] ;
+			mp[2] = pt[2] ;
+		}
+	};
+};
+
+// leaf, but not at max depth
+// created by merging child-nodes
+class PseudoLeafNode : public QEFMixin {
+public:
+	// Construction, without QEF
+	PseudoLeafNode ( int ht, unsigned char sg, float coord[3] ) : QEFMixin( PSEUDOLEAF ) {
+		height = ht;
+		signs = sg;
+		setQEF( QEFPool::NONE, coord );
+		index = -1 ;
+	};
+
+	// construction with QEF
+	PseudoLeafNode ( int ht, unsigned char sg, unsigned int q, float mp1[3] ) : QEFMixin( PSEUDOLEAF ) {
+		height = ht ;
+		signs = sg ;
+		setQEF( q, mp1 );
+		index = -1 ;
+	};
+};
+
+
+/* Global variables */
+
+// map from the 12 edges of the cube to the 8 vertices.
+// example: edge 0 connects vertices 0,4
+const int edgevmap[12][2] = {{0,4},{1,5},{2,6},{3,7},{0,2},{1,3},{4,6},{5,7},{0,1},{2,3},{4,5},{6,7}};
+const int edgemask[3] = { 5, 3, 6 } ;
+
+// direction from parent st to each of the eight child st
+// st is the corner of the cube with minimum (x,y,z) coordinates
+const int vertMap[8][3] = {{0,0,0},{0,0,1},{0,1,0},{0,1,1},{1,0,0},{1,0,1},{1,1,0},{1,1,1}} ;
+
+// map from the 6 faces of the cube to the 4 vertices that bound the face
+const int faceMap[6][4] = {{4, 8, 5, 9}, {6, 10, 7, 11},{0, 8, 1, 10},{2, 9, 3, 11},{0, 4, 2, 6},{1, 5, 3, 7}} ;
+
+// first used by cellProcCount()
+// used in cellProcContour(). 
+// between 8 child-nodes there are 12 faces.
+// first two numbers are child-pairs, to be processed by faceProcContour()
+// the last number is "dir" ?
+const int cellProcFaceMask[12][3] = {{0,4,0},{1,5,0},{2,6,0},{3,7,0},{0,2,1},{4,6,1},{1,3,1},{5,7,1},{0,1,2},{2,3,2},{4,5,2},{6,7,2}} ;
+
+
+// then used in cellProcContour() when calling edgeProc()
+// between 8 children there are 6 common edges
+// table lists the 4 children that share the edge
+// the last number is "dir" ?
+const int cellProcEdgeMask[6][5] = {{0,1,2,3,0},{4,5,6,7,0},{0,4,1,5,1},{2,6,3,7,1},{0,2,4,6,2},{1,3,5,7,2}} ;
+
+// usde by faceProcCount()
+const int faceProcFaceMask[3][4][3] = {
+	{{4,0,0},{5,1,0},{6,2,0},{7,3,0}},
+	{{2,0,1},{6,4,1},{3,1,1},{7,5,1}},
+	{{1,0,2},{3,2,2},{5,4,2},{7,6,2}}
+} ;
+const int faceProcEdgeMask[3][4][6] = {
+	{{1,4,0,5,1,1},{1,6,2,7,3,1},{0,4,6,0,2,2},{0,5,7,1,3,2}},
+	{{0,2,3,0,1,0},{0,6,7,4,5,0},{1,2,0,6,4,2},{1,3,1,7,5,2}},
+	{{1,1,0,3,2,0},{1,5,4,7,6,0},{0,1,5,0,4,1},{0,3,7,2,6,1}}
+};
+const int edgeProcEdgeMask[3][2][5] = {
+	{{3,2,1,0,0},{7,6,5,4,0}},
+	{{5,1,4,0,1},{7,3,6,2,1}},
+	{{6,4,2,0,2},{7,5,3,1,2}},
+};
+const int processEdgeMask[3][4] = {{3,2,1,0},{7,5,6,4},{11,10,9,8}} ;
+
+const int dirCell[3][4][3] = {
+	{{0,-1,-1},{0,-1,0},{0,0,-1},{0,0,0}},
+	{{-1,0,-1},{-1,0,0},{0,0,-1},{0,0,0}},
+	{{-1,-1,0},{-1,0,0},{0,-1,0},{0,0,0}}
+};
+const int dirEdge[3][4] = {
+	{3,2,1,0},
+	{7,6,5,4},
+	{11,10,9,8}
+};
+
+
+// A subtree of the DCF stream that is decoded on its own by DCF_PARALLEL
+struct DCFSubtree {
+	const char* data ;  // first byte of the subtree in the mapped file
+	int st[3], len, ht ;
+	OctreeNode** slot ; // where the decoded subtree is attached
+};
+
+// Leaves of one worker thread whose minimizers are not solved yet
+struct PendingLeaves {
+	enum { BATCH_SIZE = 4096 } ; // solved when this many are pending
+	QEFBatch qefs ;
+	std::vector<LeafNode*> leaves ;
+	std::vector<int> cells ;  // st and len of each leaf, for CLAMP
+};
+
+// the QEFs of the children of a node summed up and solved, as simplify() collapses them
+struct MergedQEF {
+	QEFData q ;
+	float mp[3] ;         // minimizer
+	float error ;         // QEF error at mp
+	unsigned char signs ;
+	int height ;          // of the pseudo-leaf
+	int count ;           // children merged, 0 if there were none
+};
+
+// What an internal node becomes when it is collapsed, see buildCollapseTree().
+// At threshold t the node is collapsed if maxError <= t.
+struct CollapseEntry {
+	float error ;         // QEF error of the node collapsed on its own
+	float maxError ;      // largest error in its subtree, the smallest threshold that collapses it
+	PseudoLeafNode* node ; // the collapsed node, NULL if it has no children
+	int count ;           // leaves and pseudo-leaves merged into node
+	int children ;        // internal children, collapsed before this node
+	int parent ;          // entry of the parent node, -1 for the root
+	int cut ;             // collapsed in the current cut
+};
+
+// One cell, face or edge call of cellProcContour() or cellProcContourNoInter2()
+// at opts.contourDepth, run on its own by genMesh() or genMeshNoInter2()
+struct ContourJob {
+	enum { CELL, FACE, EDGE } ;
+	int kind ;
+	OctreeNode* node[4] ; // 1, 2 or 4 nodes
+	int dir ;
+	int st[3], len ;      // NoInter2 only
+};
+
+// Face vertices of genMeshNoInter2(), keyed by the two nodes sharing the
+// face and shared by all jobs. The keys are spread over SHARDS tables with
+// a lock each. Slot s of shard h is face vertex s * SHARDS + h.
+struct FaceVertexTable {
+	enum { SHARDS = 64 } ;
+	HashMap map[ SHARDS ] ;
+	std::mutex lock[ SHARDS ] ;
+	int count[ SHARDS ] ;
+
+	FaceVertexTable( ) {
+		for ( int i = 0 ; i < SHARDS ; i ++ )
+			count[i] = 0 ;
+	};
+
+	/// Find the face vertex of a and b, or add one if test() says there is
+	/// one. Returns 1 if found, 2 if added, 0 if there is none.
+	template <class F>
+	int findOrAdd( const void* a, const void* b, int& vert, F test ) {
+		uintptr_t k = (uintptr_t) a * 31 + (uintptr_t) b ;
+		int h = (int) ( ( k ^ ( k >> 7 ) ^ ( k >> 17 ) ) % SHARDS ) ;
+		std::lock_guard<std::mutex> guard( lock[h] ) ;
+		if ( map[h].FindKey( a, b, vert ) )
+			return 1 ;
+		if ( ! test( ) )
+			return 0 ;
+		vert = count[h] ++ * SHARDS + h ;
+		map[h].InsertKey( a, b, vert ) ;
+		return 2 ;
+	};
+
+	/// Upper bound of the face vertex numbers given out
+	int slots( ) {
+		int n = 0 ;
+		for ( int i = 0 ; i < SHARDS ; i ++ )
+			n = count[i] > n ? count[i] : n ;
+		return n * SHARDS ;
+	};
+};
+
+// What one genMeshNoInter2() job adds to the mesh, in the order the serial
+// traversal would. Vertices are references tagged with their kind: leaf
+// vertices by leaf number, face vertices by FaceVertexTable number and
+// edge vertices by their place in edgePos. The jobs are merged in order.
+struct NoInterJob {
+	enum { LEAF = 0u << 30, FACE = 1u << 30, EDGE = 2u << 30, KIND = 3u << 30 } ;
+	int id ;
+	std::vector<ContourJob>* plan ;  // set while the jobs are planned, see cellProcContourNoInter2()
+	std::vector<unsigned int> events ; // vertices as they are met: new leaves, face vertices, edge vertices
+	std::vector<unsigned int> tris ;  // 3 references per triangle
+	std::vector<float> edgePos ;      // 3 floats per edge vertex
+	std::vector<unsigned int> faceMoves ; // face vertices moved toward an edge vertex ...
+	std::vector<float> faceCents ;    // ... at these points
+	int founds, news, edgeVerts ;
+
+	NoInterJob( ) {
+		id = -1 ;
+		plan = NULL ;
+		founds = news = edgeVerts = 0 ;
+	};
+};
+
+// shared by the jobs of genMeshNoInter2()
+struct NoInterShared {
+	FaceVertexTable faces ;
+	std::vector< std::atomic<int> > leafJob ; // last job that recorded each leaf vertex
+};
+
+/**
+ * Class for building and processing an octree
+ */
+class Octree {
+public:
+	OctreeNode* root ;
+	int dimen; 	   // Length of grid
+	int maxDepth;
+	int hasQEF;    // used in simplify(), cleared by releaseQEF()
+	int faceVerts, edgeVerts;
+	int actualTris ; // number of triangles produced by cellProcContour()
+	int founds, news ;
+public:
+	Octree ( char* fname , double threshold, OctreeOptions opts = OctreeOptions() ) ;
+	~Octree ( ) ;
+	void simplify ( float thresh ) ;
+	void buildCollapseTree ( ) ; // collapse errors of every node, for cutCollapseTree()
+	void cutCollapseTree ( float thresh ) ; // make root the tree simplify( thresh ) would give, without solving QEFs
+	void cutToBudget ( int maxVertices, int maxTriangles ) ; // collapse the cheapest nodes until the output fits
+	void releaseQEF ( ) ; // drop the QEF data, the tree can not be simplified afterwards
+	QEFData getQEF ( unsigned int q ) { return qefPool.get( q ) ; } ;
+	void genMesh ( Mesh& mesh ) ; // original algorithm, into mesh
+	void genMeshNoInter2 ( Mesh& mesh ) ; // intersection-free algorithm, into mesh
+	void genContour ( char* fname ) ; // genMesh() written to a PLY file
+	//void genContourNoInter ( char* fname ) ; // not called from main() ?
+	void genContourNoInter2 ( char* fname ) ;
+	int verifyMesh ( const Mesh& mesh, char* outname ) ; // self-intersections of a mesh from genMesh*(), between touching cells
+
+	// DCF2 conversion and index table
+	static void convertDCF2 ( char* dcfname, char* outname, int indexDepth ) ;
+	static int readDCF2Table ( char* fname, int& dimen, int& indexDepth, std::vector<DCF2Entry>& table ) ;
+	
+	void printMemoryStats ( ) ;
+
+	void countNodes(int result[3]) {
+		for (int i=0;i<3;i++)
+			result[i]=0;
+		countNodes(this->root, result);
+	}
+	
+	void countNodes( OctreeNode* node, int result[3] ) {
+		switch( node->getType() ) {
+			case INTERNAL:
+				result[0]++;
+				InternalNode* inode;
+				inode = (InternalNode*)node;
+				for (int i=0;i<8;i++) {
+					if (inode->child[i]!=NULL)
+						countNodes( inode->child[i], result);
+				}
+				break;
+			case PSEUDOLEAF:
+				result[1]++;
+				break;
+			case LEAF:
+				result[2]++;
+				break;
+		}
+	}
+private:
+	float simplify_threshold;
+	OctreeOptions opts;
+	std::vector<NodeArena*> arenas; // node storage, one arena per worker thread
+	QEFPool qefPool; // QEF data of leaves and pseudo-leaves
+	std::vector<QEFPool::Cursor> qefCursors; // one per worker thread, like arenas
+	std::vector<PendingLeaves> pending; // one per worker thread, used with opts.batchQEF
+	NodeArena* nodeArena ( int worker = 0 ) ;
+	QEFPool::Cursor& qefCursor ( int worker = 0 ) ;
+	OctreeNode* makeLeaf ( int worker, int ht, unsigned char sg, int st[3], int len, int numint, float inters[12][3], float norms[12][3] ) ;
+	void addPending ( int worker, LeafNode* lnode, QEFData& q, float pt[3], int st[3], int len ) ;
+	void solvePending ( int worker ) ;
+	void solveLazy ( OctreeNode* node, int st[3], int len, int& count ) ;
+	void reserveArenas ( int n ) ;
+	void recycleNode ( OctreeNode* node, int worker = 0 ) ;
+	OctreeNode* simplify( OctreeNode* node, int st[3], int len, float thresh, int worker, TaskPool* pool ) ;
+	OctreeNode* collapseNode ( InternalNode* inode, int st[3], int len, float thresh, int worker ) ;
+	float streamThreshold ; // simplify threshold used by the readers with opts.streamSimplify, -1 if not
+	void mergeChildren ( OctreeNode* child[8], int st[3], int len, MergedQEF& m ) ;
+	PseudoLeafNode* makePseudoLeaf ( MergedQEF& m, int worker ) ;
+
+	// collapse-error tree
+	OctreeNode* fullRoot ; // the unsimplified tree, root is a cut of it
+	std::vector<CollapseEntry> collapseTree ; // indexed by InternalNode::collapse
+	std::vector<InternalNode*> cutNodes ; // internal nodes made by the last cut
+	float buildCollapseTree ( OctreeNode* node, int st[3], int len ) ;
+	OctreeNode* cutCollapseTree ( OctreeNode* node ) ;
+	void replaceCut ( ) ;
+
+	//void readSOG ( char* fname ) ; // read SOG file
+	//OctreeNode* readSOG ( FILE* fin, int st[3], int len, int ht, float origin[3], float range ) ;
+	void readDCF ( char* fname ) ; // read DCF file
+	OctreeNode* readDCF ( FILE* fin, int st[3], int len, int ht ) ;
+	void readDCFMapped ( char* fname ) ; // read DCF file through mmap
+	OctreeNode* readDCF ( const char*& cur, const char* end, int st[3], int len, int ht, int worker ) ;
+	void scanDCF ( const char*& cur, const char* end, int st[3], int len, int ht, int depth, OctreeNode** slot, std::vector<DCFSubtree>& tasks ) ;
+	void setDimen ( int dimen ) ;
+	void readDCF2 ( char* fname ) ; // read indexed DCF2 file
+	void buildDCF2 ( const std::vector<DCF2Entry>& table, int& next, int indexDepth, const std::vector<char>& selected, 
+		const char* data, const char* end, OctreeNode** slot, std::vector<DCFSubtree>& tasks ) ;
+
+// Contouring
+	void generateVertexIndex( OctreeNode* node, int& offset, std::vector<float>& verts ) ; // not used by NoInter2-functions?
+	void leafBoxes( OctreeNode* node, int st[3], int len, std::vector<BoundingBox>& boxes ) ; // cell of each leaf, by node->index
+
+	void cellProcContour ( OctreeNode* node, std::vector<unsigned int>& tris ) ;
+	void faceProcContour ( OctreeNode* node[2], int dir, std::vector<unsigned int>& tris ) ;
+	void edgeProcContour ( OctreeNode* node[4], int dir, std::vector<unsigned int>& tris ) ;
+	void processEdgeWrite ( OctreeNode* node[4], int dir, std::vector<unsigned int>& tris ) ;
+	// the calls of cellProcContour() down to opts.contourDepth, in the order it makes them
+	void cellProcJobs ( OctreeNode* node, int depth, std::vector<ContourJob>& jobs ) ;
+	void faceProcJobs ( OctreeNode* node[2], int dir, int depth, std::vector<ContourJob>& jobs ) ;
+	void edgeProcJobs ( OctreeNode* node[4], int dir, int depth, std::vector<ContourJob>& jobs ) ;
+	void contourParallel ( std::vector<unsigned int>& tris, int nthreads ) ;
+	void cellProcCount ( OctreeNode* node, int& nverts, int& nfaces ) ;
+	void faceProcCount ( OctreeNode* node[2], int dir, int& nverts, int& nfaces ) ;
+	void edgeProcCount ( OctreeNode* node[4], int dir, int& nverts, int& nfaces ) ;
+	void processEdgeCount ( OctreeNode* node[4], int dir, int& nverts, int& nfaces ) ;
+
+/* not used !?
+	void cellProcContourNoInter( OctreeNode* node, int st[3], int len, HashMap2* hash, TriangleList* list, int& numTris ) ;
+	void faceProcContourNoInter( OctreeNode* node[2], int st[3], int len, int dir, HashMap2* hash, TriangleList* list, int& numTris ) ;
+	void edgeProcContourNoInter( OctreeNode* node[4], int st[3], int len, int dir, HashMap2* hash, TriangleList* list, int& numTris ) ;
+	void processEdgeNoInter( OctreeNode* node[4], int st[3], int len, int dir, HashMap2* hash, TriangleList* list, int& numTris ) ;
+*/
+
+	void cellProcContourNoInter2( OctreeNode* node, int st[3], int len, int depth, NoInterShared& shared, NoInterJob& job ) ;
+	void faceProcContourNoInter2( OctreeNode* node[2], int st[3], int len, int dir, int depth, NoInterShared& shared, NoInterJob& job ) ;
+	void edgeProcContourNoInter2( OctreeNode* node[4], int st[3], int len, int dir, int depth, NoInterShared& shared, NoInterJob& job ) ;
+	void processEdgeNoInter2( OctreeNode* node[4], int st[3], int len, int dir, NoInterShared& shared, NoInterJob& job ) ;
+
+	/**
+	 *  Non-intersecting test and tesselation
+	 */
+	int testFace( int st[3], int len, int dir, float v1[3], float v2[3] ) ;
+	int testEdge( int st[3], int len, int dir, OctreeNode* node[4], float v[4][3] ) ;
+	// not called?
+	// void makeFaceVertex( int st[3], int len, int dir, OctreeNode* node1, OctreeNode* node2, float v[3] ) ;
+	void makeEdgeVertex( int st[3], int len, int dir, OctreeNode* node[4], float mp[4][3], float v[3] ) ;
+};
+
+
+#endif
@@ -0,0 +1,164 @@
+/*
+
+  Microbenchmark of the QEF solvers in eigen.cpp.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public License
+  (LGPL) as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "eigen.hpp"
+#include "Parallel.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+/*	Parameters
+ *	argv[1]:	(OPTIONAL) number of QEFs (default 1000000)
+ *	argv[2]:	(OPTIONAL) number of threads for the parallel runs (default one per core)
+ *
+ *	Every QEF is made of 1 to 6 planes through random points of a unit cell
+ *	somewhere in a 256^3 grid, like the leaves of a .dcf file.
+ *	Each calcPoint() method solves all of them once on one thread and once
+ *	on all threads; the parallel run must give the same minimizers.
+*/
+
+struct BenchQEF {
+	float ata[6], atb[3], btb ;
+	float mid[3] ;
+	BoundingBoxf box ;
+};
+
+static float frand( ) {
+	return (float) rand( ) / (float) RAND_MAX ;
+}
+
+static void makeQEFs( int n, std::vector<BenchQEF>& qefs ) {
+	srand( 1 ) ;
+	qefs.resize( n ) ;
+	for ( int i = 0 ; i < n ; i ++ ) {
+		BenchQEF& q = qefs[i] ;
+		float st[3] ;
+		for ( int j = 0 ; j < 3 ; j ++ )
+			st[j] = (float) ( rand( ) % 256 ) ;
+		memset( q.ata, 0, sizeof( q.ata ) ) ;
+		memset( q.atb, 0, sizeof( q.atb ) ) ;
+		memset( q.mid, 0, sizeof( q.mid ) ) ;
+		q.btb = 0 ;
+
+		int planes = 1 + rand( ) % 6 ;
+		for ( int k = 0 ; k < planes ; k ++ ) {
+			float p[3], nm[3], len = 0 ;
+			for ( int j = 0 ; j < 3 ; j ++ ) {
+				p[j] = st[j] + frand( ) ;
+				nm[j] = frand( ) * 2 - 1 ;
+				len += nm[j] * nm[j] ;
+				q.mid[j] += p[j] ;
+			}
+			len = sqrtf( len ) ;
+			if ( len < 0.001f ) {
+				nm[0] = 1 ; nm[1] = 0 ; nm[2] = 0 ; len = 1 ;
+			}
+			for ( int j = 0 ; j < 3 ; j ++ )
+				nm[j] /= len ;
+			float d = nm[0] * p[0] + nm[1] * p[1] + nm[2] * p[2] ;
+			q.ata[0] += nm[0] * nm[0] ;
+			q.ata[1] += nm[0] * nm[1] ;
+			q.ata[2] += nm[0] * nm[2] ;
+			q.ata[3] += nm[1] * nm[1] ;
+			q.ata[4] += nm[1] * nm[2] ;
+			q.ata[5] += nm[2] * nm[2] ;
+			for ( int j = 0 ; j < 3 ; j ++ )
+				q.atb[j] += nm[j] * d ;
+			q.btb += d * d ;
+		}
+		for ( int j = 0 ; j < 3 ; j ++ )
+			q.mid[j] /= planes ;
+		q.box.begin.x = st[0] ; q.box.end.x = st[0] + 1 ;
+		q.box.begin.y = st[1] ; q.box.end.y = st[1] + 1 ;
+		q.box.begin.z = st[2] ; q.box.end.z = st[2] + 1 ;
+	}
+}
+
+// solve qefs[i] for i in [begin, end) with solver, minimizers go to out[3 * i]
+static double solveRange( std::vector<BenchQEF>& qefs, int begin, int end, QEFSolver solver, float* out ) {
+	double err = 0 ;
+	float mat[10] ;
+	for ( int i = begin ; i < end ; i ++ ) {
+		BenchQEF& q = qefs[i] ;
+		err += calcPoint( q.ata, q.atb, q.btb, q.mid, out + 3 * i, &q.box, mat, solver ) ;
+	}
+	return err ;
+}
+
+int main( int args, char* argv[] )
+{
+	int n = args > 1 ? atoi( argv[1] ) : 1000000 ;
+	int nthreads = Parallel::numThreads( args > 2 ? atoi( argv[2] ) : 0 ) ;
+	if ( n <= 0 ) {
+		printf("Usage: %s [number of QEFs] [threads]\n", argv[0] ) ;
+		return 1 ;
+	}
+
+	std::vector<BenchQEF> qefs ;
+	makeQEFs( n, qefs ) ;
+	std::vector<float> single( 3 * (size_t) n ), parallel( 3 * (size_t) n ) ;
+
+	const struct { QEFSolver solver ; const char* name ; } solvers[] = {
+		{ QEF_PSEUDO_INVERSE, "pseudo-inverse" },
+		{ QEF_DESCENT, "descent" },
+		{ QEF_DESCENT_FIXED, "descent-fixed" },
+		{ QEF_DESCENT_HYBRID, "hybrid" },
+		{ QEF_MIDPOINT, "midpoint" },
+	};
+
+	printf("%d QEFs, parallel runs on %d threads\n", n, nthreads ) ;
+	printf("%-16s %12s %12s %14s\n", "solver", "ns/solve", "ns/solve MT", "mean error" ) ;
+	for ( size_t s = 0 ; s < sizeof( solvers ) / sizeof( solvers[0] ) ; s ++ ) {
+		double t0 = Parallel::wallTime( ) ;
+		double err = solveRange( qefs, 0, n, solvers[s].solver, &single[0] ) ;
+		double t1 = Parallel::wallTime( ) ;
+
+		const int BLOCK = 4096 ;
+		int nblocks = ( n + BLOCK - 1 ) / BLOCK ;
+		Parallel::parallelFor( nblocks, nthreads, [&]( int b, int worker ) {
+			int end = ( b + 1 ) * BLOCK < n ? ( b + 1 ) * BLOCK : n ;
+			solveRange( qefs, b * BLOCK, end, solvers[s].solver, &parallel[0] ) ;
+		} ) ;
+		double t2 = Parallel::wallTime( ) ;
+
+		printf("%-16s %12.1f %12.1f %14.6g\n", solvers[s].name,
+			1e9 * ( t1 - t0 ) / n, 1e9 * ( t2 - t1 ) / n, err / n ) ;
+		if ( memcmp( &single[0], &parallel[0], single.size( ) * sizeof( float ) ) != 0 ) {
+			printf("Wrong! %s gives different minimizers on several threads\n", solvers[s].name ) ;
+			return 1 ;
+		}
+	}
+
+	// calcPointBatch(), which only does the pseudo-inverse
+	QEFBatch batch ;
+	for ( int i = 0 ; i < n ; i ++ )
+		batch.add( qefs[i].ata, qefs[i].atb, qefs[i].btb, qefs[i].mid ) ;
+	double t0 = Parallel::wallTime( ) ;
+	batch.solve( ) ;
+	double t1 = Parallel::wallTime( ) ;
+	double err = 0 ;
+	for ( int i = 0 ; i < n ; i ++ )
+		err += batch.error[i] ;
+	printf("%-16s %12.1f %12s %14.6g\n", "batch", 1e9 * ( t1 - t0 ) / n, "-", err / n ) ;
+
+	return 0 ;
+}